@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// System call numbers for the elevator
+#define ISSUE_REQUEST 336
+#define ISSUE_REQUESTS 338
+
+#define MAX_FLOOR 10
+#define MAX_BATCH 1024
+
+struct elevator_request
+{
+	int type;
+	int start;
+	int dest;
+};
+
+struct Worker
+{
+	pthread_t thread;
+	unsigned int seed;
+	int requests;
+	int batch;
+	long * latency;		// Nanoseconds per system call
+	int calls;
+	int failed;
+};
+
+static pthread_barrier_t startLine;
+
+static long nowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/*
+Fills in a random request with different start and destination floors.
+*/
+
+static void randomRequest(struct elevator_request * req, unsigned int * seed)
+{
+	req->type = rand_r(seed) % 4 + 1;
+	req->start = rand_r(seed) % MAX_FLOOR + 1;
+
+	do
+	{
+		req->dest = rand_r(seed) % MAX_FLOOR + 1;
+	} while (req->dest == req->start);
+}
+
+/*
+Issues the worker's requests one at a time, or batch at a time with issue_requests, timing
+every system call.
+*/
+
+static void * issueLoop(void * arg)
+{
+	struct Worker * w = arg;
+	struct elevator_request req[MAX_BATCH];
+	int status[MAX_BATCH];
+	int done = 0;
+	int n, i;
+	long t0;
+	long ret;
+
+	pthread_barrier_wait(&startLine);
+
+	while (done < w->requests)
+	{
+		n = (w->batch > 1) ? w->batch : 1;
+		if (n > w->requests - done)
+		{
+			n = w->requests - done;
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			randomRequest(&req[i], &w->seed);
+		}
+
+		t0 = nowNs();
+
+		if (w->batch > 1)
+		{
+			ret = syscall(ISSUE_REQUESTS, req, n, status);
+			w->failed += (ret < 0) ? n : n - ret;
+		}
+		else
+		{
+			ret = syscall(ISSUE_REQUEST, req[0].type, req[0].start, req[0].dest);
+			w->failed += (ret != 0);
+		}
+
+		w->latency[w->calls++] = nowNs() - t0;
+		done += n;
+	}
+
+	return NULL;
+}
+
+static int compareLong(const void * a, const void * b)
+{
+	long x = *(const long *) a;
+	long y = *(const long *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+Runs one round with the given number of issuing threads and prints one result line.
+*/
+
+static void runRound(int threads, int requests, int batch)
+{
+	struct Worker * workers = calloc(threads, sizeof(*workers));
+	long * all;
+	long total = 0;
+	long elapsed;
+	long t0;
+	int calls = 0;
+	int failed = 0;
+	int perThread = (batch > 1) ? (requests + batch - 1) / batch : requests;
+	int i;
+
+	pthread_barrier_init(&startLine, NULL, threads + 1);
+
+	for (i = 0; i < threads; i++)
+	{
+		workers[i].seed = 1234 + i;
+		workers[i].requests = requests;
+		workers[i].batch = batch;
+		workers[i].latency = malloc(perThread * sizeof(long));
+		pthread_create(&workers[i].thread, NULL, issueLoop, &workers[i]);
+	}
+
+	t0 = nowNs();
+	pthread_barrier_wait(&startLine);
+
+	for (i = 0; i < threads; i++)
+	{
+		pthread_join(workers[i].thread, NULL);
+	}
+
+	elapsed = nowNs() - t0;
+
+	all = malloc((long) threads * perThread * sizeof(long));
+
+	for (i = 0; i < threads; i++)	// Pool every latency sample for the percentiles
+	{
+		memcpy(all + calls, workers[i].latency, workers[i].calls * sizeof(long));
+		calls += workers[i].calls;
+		failed += workers[i].failed;
+		free(workers[i].latency);
+	}
+
+	qsort(all, calls, sizeof(long), compareLong);
+
+	for (i = 0; i < calls; i++)
+	{
+		total += all[i];
+	}
+
+	printf("threads=%d batch=%d requests=%ld failed=%d mean_ns=%ld p50_ns=%ld p99_ns=%ld max_ns=%ld req_per_sec=%.0f\n",
+		threads, batch, (long) threads * requests, failed, total / calls, all[calls / 2],
+		all[(long) calls * 99 / 100], all[calls - 1], (double) threads * requests * 1e9 / elapsed);
+
+	pthread_barrier_destroy(&startLine);
+	free(all);
+	free(workers);
+}
+
+/*
+Measures issue_request latency with 1, 8 and 64 threads issuing at once.
+Usage: ./issue_bench.x [requests per thread] [batch size]
+A batch size above 1 uses the issue_requests system call instead.
+*/
+
+int main(int argc, char ** argv)
+{
+	int threads[] = { 1, 8, 64 };
+	int requests = (argc > 1) ? atoi(argv[1]) : 1000;
+	int batch = (argc > 2) ? atoi(argv[2]) : 1;
+	int i;
+
+	if ((requests <= 0) || (batch > MAX_BATCH))
+	{
+		fprintf(stderr, "usage: %s [requests per thread] [batch size <= %d]\n", argv[0], MAX_BATCH);
+		return 1;
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		runRound(threads[i], requests, batch);
+	}
+
+	return 0;
+}
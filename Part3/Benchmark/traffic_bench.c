@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// System call numbers for the elevator
+#define ISSUE_REQUEST 336
+#define ISSUE_TICKET 339
+#define WAIT_TICKET 340
+
+#define TICKET_DROPOFF 2	// wait_ticket event, as in elevator.h
+
+#define MAX_FLOOR 10
+#define MAX_THREADS 1024
+
+struct Arrival
+{
+	double time;	// Seconds from the start of the run
+	int type;
+	int start;
+	int dest;
+};
+
+/*
+Result of issuing one arrival. ticket is -1 until it has been issued, then the ticket id,
+or -2 if the request was not accepted.
+*/
+
+struct Issued
+{
+	int ticket;
+	long latency;	// Nanoseconds in the system call
+	double lag;	// Seconds issued behind schedule
+	int status;	// 0 accepted, 1 refused, or errno
+};
+
+enum Profile { UNIFORM, UP_PEAK, LUNCH, DOWN_PEAK };
+
+static const char * profileNames[] = { "uniform", "up", "lunch", "down" };
+
+static struct Arrival * arrivals;
+static struct Issued * issued;
+static long arrivalCount;
+static long nextArrival;	// Next arrival for an issuing thread to take
+static double speedup = 1;
+static int tickets;		// Issue tickets and wait for every drop off
+static long startNs;
+
+static pthread_mutex_t issuedLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t issuedCond = PTHREAD_COND_INITIALIZER;
+
+static long nowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int randomFloor(unsigned int * seed, int low, int high)
+{
+	return low + rand_r(seed) % (high - low + 1);
+}
+
+/*
+Fills in the floors of one request of a traffic profile. Up-peak is mostly people arriving
+at the lobby, down-peak mostly people leaving for it, and lunch a mix of both ways with some
+interfloor traffic. Everything else is uniform between floors.
+*/
+
+static void profileFloors(enum Profile profile, int floors, unsigned int * seed, struct Arrival * a)
+{
+	int pick = rand_r(seed) % 100;
+
+	if (((profile == UP_PEAK) && (pick < 90)) || ((profile == LUNCH) && (pick < 40)))
+	{
+		a->start = 1;
+		a->dest = randomFloor(seed, 2, floors);
+	}
+	else if (((profile == DOWN_PEAK) && (pick < 90)) || ((profile == LUNCH) && (pick < 80)))
+	{
+		a->start = randomFloor(seed, 2, floors);
+		a->dest = 1;
+	}
+	else
+	{
+		a->start = randomFloor(seed, 1, floors);
+
+		do
+		{
+			a->dest = randomFloor(seed, 1, floors);
+		} while (a->dest == a->start);
+	}
+}
+
+/*
+Generates Poisson arrivals at perMinute requests a minute for the given number of seconds.
+Returns the number of arrivals.
+*/
+
+static long generate(enum Profile profile, double perMinute, double seconds, int floors, unsigned int seed)
+{
+	long size = 1024;
+	long count = 0;
+	double t = 0;
+
+	arrivals = malloc(size * sizeof(*arrivals));
+
+	while (arrivals != NULL)
+	{
+		t += -log((rand_r(&seed) + 1.0) / (RAND_MAX + 2.0)) * 60 / perMinute;
+
+		if (t >= seconds)
+		{
+			break;
+		}
+
+		if (count == size)
+		{
+			size *= 2;
+			arrivals = realloc(arrivals, size * sizeof(*arrivals));
+
+			if (arrivals == NULL)
+			{
+				break;
+			}
+		}
+
+		arrivals[count].time = t;
+		arrivals[count].type = rand_r(&seed) % 4 + 1;
+		profileFloors(profile, floors, &seed, &arrivals[count]);
+		count++;
+	}
+
+	return (arrivals != NULL) ? count : -1;
+}
+
+/*
+Reads a trace of one request per line, "seconds type start dest", the format elevator_sim.x
+reads too. Lines that do not parse are skipped. Returns the number of arrivals, or -1.
+*/
+
+static long readTrace(const char * path)
+{
+	FILE * in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+	long size = 1024;
+	long count = 0;
+	char line[256];
+	struct Arrival a;
+
+	if (in == NULL)
+	{
+		perror(path);
+		return -1;
+	}
+
+	arrivals = malloc(size * sizeof(*arrivals));
+
+	while ((arrivals != NULL) && (fgets(line, sizeof(line), in) != NULL))
+	{
+		if (sscanf(line, "%lf %d %d %d", &a.time, &a.type, &a.start, &a.dest) != 4)
+		{
+			continue;
+		}
+
+		if (count == size)
+		{
+			size *= 2;
+			arrivals = realloc(arrivals, size * sizeof(*arrivals));
+
+			if (arrivals == NULL)
+			{
+				break;
+			}
+		}
+
+		arrivals[count++] = a;
+	}
+
+	if (in != stdin)
+	{
+		fclose(in);
+	}
+
+	return (arrivals != NULL) ? count : -1;
+}
+
+/*
+Takes arrivals in order, sleeps until each one is due and issues it with issue_request, or
+issue_ticket when waiting for drop offs.
+*/
+
+static void * issueLoop(void * arg)
+{
+	struct timespec due;
+	struct Arrival * a;
+	struct Issued result;
+	long i, dueNs, t0;
+	long ret;
+
+	while ((i = __sync_fetch_and_add(&nextArrival, 1)) < arrivalCount)
+	{
+		a = &arrivals[i];
+		dueNs = startNs + (long) (a->time * 1e9 / speedup);
+		due.tv_sec = dueNs / 1000000000L;
+		due.tv_nsec = dueNs % 1000000000L;
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL) == EINTR)
+		{
+		}
+
+		t0 = nowNs();
+
+		if (tickets)
+		{
+			ret = syscall(ISSUE_TICKET, a->type, a->start, a->dest, -1);
+		}
+		else
+		{
+			ret = syscall(ISSUE_REQUEST, a->type, a->start, a->dest);
+		}
+
+		result.latency = nowNs() - t0;
+		result.lag = (t0 - dueNs) / 1e9 * speedup;
+		result.status = (ret < 0) ? errno : 0;
+		result.ticket = ((ret >= 0) && tickets) ? (int) ret : -2;
+
+		if ((!tickets) && (ret > 0))	// issue_request returns 1 for a bad request
+		{
+			result.status = 1;
+		}
+
+		pthread_mutex_lock(&issuedLock);
+		issued[i] = result;
+		pthread_cond_broadcast(&issuedCond);
+		pthread_mutex_unlock(&issuedLock);
+	}
+
+	return NULL;
+}
+
+static int compareDouble(const void * a, const void * b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+static double percentile(double * sorted, long count, int percent)
+{
+	return (count > 0) ? sorted[(count - 1) * percent / 100] : 0;
+}
+
+static void printSeconds(const char * name, double * values, long count)
+{
+	qsort(values, count, sizeof(double), compareDouble);
+	printf(" %s_p50_s=%.2f %s_p90_s=%.2f %s_p99_s=%.2f %s_max_s=%.2f", name, percentile(values, count, 50),
+		name, percentile(values, count, 90), name, percentile(values, count, 99), name,
+		(count > 0) ? values[count - 1] : 0);
+}
+
+/*
+Collects every ticket in arrival order, waiting for its drop off. The kernel records the
+times, so collecting late does not skew them. Returns the number delivered.
+*/
+
+static long collectTickets(double * wait, double * trip, double * lastDelivered)
+{
+	unsigned long long times[3];	// Issue, board and drop off, CLOCK_MONOTONIC nanoseconds
+	long delivered = 0;
+	long i;
+	int ticket;
+
+	for (i = 0; i < arrivalCount; i++)
+	{
+		pthread_mutex_lock(&issuedLock);
+
+		while (issued[i].ticket == -1)
+		{
+			pthread_cond_wait(&issuedCond, &issuedLock);
+		}
+
+		ticket = issued[i].ticket;
+		pthread_mutex_unlock(&issuedLock);
+
+		if ((ticket < 0) || (syscall(WAIT_TICKET, ticket, TICKET_DROPOFF, times) < 0))
+		{
+			continue;
+		}
+
+		wait[delivered] = (times[1] - times[0]) / 1e9;
+		trip[delivered] = (times[2] - times[0]) / 1e9;
+		*lastDelivered = (double) ((long) times[2] - startNs) / 1e9;
+		delivered++;
+	}
+
+	return delivered;
+}
+
+static void usage(const char * name)
+{
+	fprintf(stderr, "usage: %s [-p uniform|up|lunch|down] [-r requests per minute] [-d seconds]\n"
+		"\t[-f trace|-] [-F floors] [-t threads] [-x speedup] [-s seed] [-w] [-g]\n", name);
+	exit(1);
+}
+
+/*
+Replays a building traffic profile, or a trace, against the elevator with many threads
+issuing requests, and prints one line of results. With -w every request is issued as a
+ticket and waited for, adding end to end wait and trip times. With -g the workload is only
+printed, in the trace format, for elevator_sim.x or a later -f run.
+*/
+
+int main(int argc, char ** argv)
+{
+	enum Profile profile = UNIFORM;
+	double perMinute = 30;
+	double seconds = 600;
+	const char * trace = NULL;
+	int floors = MAX_FLOOR;
+	int threads = 64;
+	int generateOnly = 0;
+	unsigned int seed = 1234;
+	pthread_t * workers;
+	double * latency, * lag, * wait, * trip;
+	double lastDelivered = 0;
+	double elapsed;
+	long accepted = 0, refused = 0, busy = 0, failed = 0;
+	long delivered = 0;
+	long i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:r:d:f:F:t:x:s:wg")) != -1)
+	{
+		switch (opt)
+		{
+			case 'p':
+				for (i = 0; (i < 4) && (strcmp(optarg, profileNames[i]) != 0); i++)
+				{
+				}
+
+				if (i == 4)
+				{
+					usage(argv[0]);
+				}
+
+				profile = i;
+				break;
+			case 'r': perMinute = atof(optarg); break;
+			case 'd': seconds = atof(optarg); break;
+			case 'f': trace = optarg; break;
+			case 'F': floors = atoi(optarg); break;
+			case 't': threads = atoi(optarg); break;
+			case 'x': speedup = atof(optarg); break;
+			case 's': seed = atoi(optarg); break;
+			case 'w': tickets = 1; break;
+			case 'g': generateOnly = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if ((perMinute <= 0) || (seconds <= 0) || (floors < 2) || (threads < 1) || (threads > MAX_THREADS) || (speedup <= 0))
+	{
+		usage(argv[0]);
+	}
+
+	arrivalCount = (trace != NULL) ? readTrace(trace) : generate(profile, perMinute, seconds, floors, seed);
+
+	if (arrivalCount < 0)
+	{
+		fprintf(stderr, "%s: could not load the workload\n", argv[0]);
+		return 1;
+	}
+
+	if (generateOnly)
+	{
+		for (i = 0; i < arrivalCount; i++)
+		{
+			printf("%.3f %d %d %d\n", arrivals[i].time, arrivals[i].type, arrivals[i].start, arrivals[i].dest);
+		}
+
+		return 0;
+	}
+
+	issued = malloc(arrivalCount * sizeof(*issued));
+	latency = malloc(arrivalCount * sizeof(double));
+	lag = malloc(arrivalCount * sizeof(double));
+	wait = malloc(arrivalCount * sizeof(double));
+	trip = malloc(arrivalCount * sizeof(double));
+	workers = calloc(threads, sizeof(*workers));
+
+	for (i = 0; i < arrivalCount; i++)
+	{
+		issued[i].ticket = -1;
+	}
+
+	startNs = nowNs();
+
+	for (i = 0; i < threads; i++)
+	{
+		pthread_create(&workers[i], NULL, issueLoop, NULL);
+	}
+
+	if (tickets)
+	{
+		delivered = collectTickets(wait, trip, &lastDelivered);
+	}
+
+	for (i = 0; i < threads; i++)
+	{
+		pthread_join(workers[i], NULL);
+	}
+
+	elapsed = (nowNs() - startNs) / 1e9;
+
+	for (i = 0; i < arrivalCount; i++)
+	{
+		latency[i] = issued[i].latency / 1e9;
+		lag[i] = issued[i].lag;
+
+		if (issued[i].status == 0)
+		{
+			accepted++;
+		}
+		else if (issued[i].status == 1)
+		{
+			refused++;
+		}
+		else if (issued[i].status == EAGAIN)
+		{
+			busy++;
+		}
+		else
+		{
+			failed++;
+		}
+	}
+
+	printf("profile=%s rate_per_min=%.1f threads=%d speedup=%.1f requests=%ld accepted=%ld refused=%ld eagain=%ld failed=%ld elapsed_s=%.1f",
+		(trace != NULL) ? "trace" : profileNames[profile], perMinute, threads, speedup, arrivalCount,
+		accepted, refused, busy, failed, elapsed);
+
+	qsort(latency, arrivalCount, sizeof(double), compareDouble);
+	printf(" issue_p50_ns=%.0f issue_p99_ns=%.0f", percentile(latency, arrivalCount, 50) * 1e9,
+		percentile(latency, arrivalCount, 99) * 1e9);
+	qsort(lag, arrivalCount, sizeof(double), compareDouble);
+	printf(" lag_max_s=%.3f", (arrivalCount > 0) ? lag[arrivalCount - 1] : 0);
+
+	if (tickets)
+	{
+		printf(" delivered=%ld per_min=%.1f", delivered, (lastDelivered > 0) ? delivered * 60 / lastDelivered : 0);
+		printSeconds("wait", wait, delivered);
+		printSeconds("trip", trip, delivered);
+	}
+
+	printf("\n");
+
+	return 0;
+}
@@ -0,0 +1,23 @@
+#include <linux/linkage.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+
+#include "systemcalls.h"
+
+int (*STUB_cancel_request)(int) = NULL;
+EXPORT_SYMBOL(STUB_cancel_request);
+
+SYSCALL_DEFINE1(cancel_request, int, ticket)
+{
+	pr_debug("Inside SYSCALL_DEFINE1 block. %s\n", __FUNCTION__);
+
+	if (STUB_cancel_request != NULL)
+	{
+		return STUB_cancel_request(ticket);
+	}
+	else
+	{
+		return -ENOSYS;
+	}
+}
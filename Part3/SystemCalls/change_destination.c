@@ -0,0 +1,23 @@
+#include <linux/linkage.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+
+#include "systemcalls.h"
+
+int (*STUB_change_destination)(int,int) = NULL;
+EXPORT_SYMBOL(STUB_change_destination);
+
+SYSCALL_DEFINE2(change_destination, int, ticket, int, destination_floor)
+{
+	pr_debug("Inside SYSCALL_DEFINE2 block. %s\n", __FUNCTION__);
+
+	if (STUB_change_destination != NULL)
+	{
+		return STUB_change_destination(ticket, destination_floor);
+	}
+	else
+	{
+		return -ENOSYS;
+	}
+}
@@ -0,0 +1,23 @@
+#include <linux/linkage.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+
+#include "systemcalls.h"
+
+int (*STUB_issue_requests)(const void __user *, int, int __user *) = NULL;
+EXPORT_SYMBOL(STUB_issue_requests);
+
+SYSCALL_DEFINE3(issue_requests, const void __user *, requests, int, count, int __user *, status)
+{
+	pr_debug("Inside SYSCALL_DEFINE3 block. %s\n", __FUNCTION__);
+
+	if (STUB_issue_requests != NULL)
+	{
+		return STUB_issue_requests(requests, count, status);
+	}
+	else
+	{
+		return -ENOSYS;
+	}
+}
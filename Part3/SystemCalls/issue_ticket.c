@@ -0,0 +1,23 @@
+#include <linux/linkage.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+
+#include "systemcalls.h"
+
+int (*STUB_issue_ticket)(int,int,int,int) = NULL;
+EXPORT_SYMBOL(STUB_issue_ticket);
+
+SYSCALL_DEFINE4(issue_ticket, int, passenger_type, int, start_floor, int, destination_floor, int, efd)
+{
+	pr_debug("Inside SYSCALL_DEFINE4 block. %s\n", __FUNCTION__);
+
+	if (STUB_issue_ticket != NULL)
+	{
+		return STUB_issue_ticket(passenger_type, start_floor, destination_floor, efd);
+	}
+	else
+	{
+		return -ENOSYS;
+	}
+}
@@ -1,4 +1,8 @@
 asmlinkage long sys_start_elevator(int);
 asmlinkage long sys_issue_request(int);
 asmlinkage long sys_stop_elevator(int);
-
+asmlinkage long sys_issue_requests(const void __user *, int, int __user *);
+asmlinkage long sys_issue_ticket(int, int, int, int);
+asmlinkage long sys_wait_ticket(int, int, u64 __user *);
+asmlinkage long sys_cancel_request(int);
+asmlinkage long sys_change_destination(int, int);
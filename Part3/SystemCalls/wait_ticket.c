@@ -0,0 +1,23 @@
+#include <linux/linkage.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+
+#include "systemcalls.h"
+
+int (*STUB_wait_ticket)(int,int,u64 __user *) = NULL;
+EXPORT_SYMBOL(STUB_wait_ticket);
+
+SYSCALL_DEFINE3(wait_ticket, int, ticket, int, flags, u64 __user *, times)
+{
+	pr_debug("Inside SYSCALL_DEFINE3 block. %s\n", __FUNCTION__);
+
+	if (STUB_wait_ticket != NULL)
+	{
+		return STUB_wait_ticket(ticket, flags, times);
+	}
+	else
+	{
+		return -ENOSYS;
+	}
+}
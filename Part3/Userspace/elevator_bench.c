@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "elevator_user.h"
+#include "elevator_car.h"
+#include "elevator_latency.h"
+
+struct Timing
+{
+	long total;	// Nanoseconds, less the cost of reading the clock
+	long calls;
+};
+
+static long clockCost;	// Least nanoseconds between two clock reads
+
+static long nowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void addTime(struct Timing * t, long t0)
+{
+	t->total += nowNs() - t0 - clockCost;
+	t->calls++;
+}
+
+static long perCall(const struct Timing * t)
+{
+	return (t->calls > 0) ? t->total / t->calls : 0;
+}
+
+/*
+Queues a passenger with a random type, start and destination, reusing someone who has been
+dropped off if there is anyone, so the building keeps the same number of people.
+*/
+
+static void requeue(Car * car, unsigned int * seed)
+{
+	int type = rand_r(seed) % BELLHOP + 1;
+	int start = rand_r(seed) % numFloors + 1;
+	int dest;
+	Passenger * p;
+
+	do
+	{
+		dest = rand_r(seed) % numFloors + 1;
+	} while (dest == start);
+
+	p = elevator_user_passenger(type, start, dest);
+
+	if (p == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	elevator_user_queue(car, p);
+}
+
+/*
+Runs the car thread's loop without its sleeps for the given number of steps with depth
+passengers per floor, timing each stop (Unload and boarding) and each pick of the next
+floor, and prints one result line.
+*/
+
+static void runRound(struct elevator_sched_ops * ops, int fill, int depth, int steps)
+{
+	struct Timing decide = {0}, stop = {0};
+	unsigned int seed = 1234;
+	Car car;
+	int unloadPass, loadPass;
+	int i, j;
+	long t0;
+
+	fillBoarding = fill;
+
+	if (elevator_user_init(&car, ops) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0; i < depth * numFloors; i++)
+	{
+		requeue(&car, &seed);
+	}
+
+	drainArrivals(&car);	// Onto the floor queues before the clock starts
+
+	for (i = 0; i < steps; i++)
+	{
+		t0 = nowNs();
+		serveFloor(&car, 0, 0, &loadPass, &unloadPass);
+		addTime(&stop, t0);
+
+		for (j = 0; j < unloadPass; j++)	// Everyone dropped off comes back
+		{
+			requeue(&car, &seed);
+		}
+
+		drainArrivals(&car);	// Not part of the decision, so not timed
+
+		t0 = nowNs();
+		chooseNextFloor(&car, 0);
+		addTime(&decide, t0);
+
+		arriveFloor(&car);
+	}
+
+	printf("policy=%s boarding=%s depth=%d steps=%d decide_ns=%ld stop_ns=%ld\n",
+		ops->name, fill ? "fill" : "fifo", depth, steps, perCall(&decide), perCall(&stop));
+
+	elevator_user_exit(&car);
+}
+
+/*
+Times the scheduling policies with 10, 100 and 1000 passengers waiting per floor.
+Usage: ./elevator_bench.x [steps] [floors]
+*/
+
+int main(int argc, char ** argv)
+{
+	int depths[] = { 10, 100, 1000 };
+	int steps = (argc > 1) ? atoi(argv[1]) : 100000;
+	int i, j, fill;
+	long t0, t1;
+
+	numFloors = (argc > 2) ? atoi(argv[2]) : MAX_FLOOR;
+
+	if ((steps <= 0) || (numFloors < 2))
+	{
+		fprintf(stderr, "usage: %s [steps] [floors >= 2]\n", argv[0]);
+		return 1;
+	}
+
+	if (elevator_latency_init() != 0)	// Unload records latencies
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	clockCost = 1000000;
+
+	for (i = 0; i < 100000; i++)	// The least reading the clock costs, to take off every call
+	{
+		t0 = nowNs();
+		t1 = nowNs();
+		clockCost = min(clockCost, t1 - t0);
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; schedPolicies[j] != NULL; j++)
+		{
+			for (fill = 0; fill <= 1; fill++)
+			{
+				runRound(schedPolicies[j], fill, depths[i], steps);
+			}
+		}
+	}
+
+	elevator_latency_exit();
+
+	return 0;
+}
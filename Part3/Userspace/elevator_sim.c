@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "elevator_user.h"
+#include "elevator_latency.h"
+
+static long wallNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static int compareArrival(const void * a, const void * b)
+{
+	const struct Arrival * x = a;
+	const struct Arrival * y = b;
+
+	return (x->time > y->time) - (x->time < y->time);
+}
+
+/*
+Reads a workload of one request per line, "seconds type start dest", with # starting a
+comment, and sorts it by arrival time. Returns the number of requests read, or -1.
+*/
+
+static long readWorkload(FILE * in, struct Arrival ** out)
+{
+	struct Arrival * list = NULL;
+	long size = 0;
+	long count = 0;
+	char line[256];
+	double seconds;
+	int type, start, dest;
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if (sscanf(line, "%lf %d %d %d", &seconds, &type, &start, &dest) != 4)
+		{
+			continue;	// Blank line or comment
+		}
+
+		if (count == size)
+		{
+			size = (size == 0) ? 1024 : size * 2;
+			list = realloc(list, size * sizeof(*list));
+
+			if (list == NULL)
+			{
+				return -1;
+			}
+		}
+
+		list[count].time = (seconds > 0) ? (u64) (seconds * NSEC_PER_SEC) : 0;
+		list[count].type = type;
+		list[count].start = start;
+		list[count].dest = dest;
+		count++;
+	}
+
+	qsort(list, count, sizeof(*list), compareArrival);
+	*out = list;
+
+	return count;
+}
+
+static double seconds(u64 us)
+{
+	return (double) us / USEC_PER_SEC;
+}
+
+static void printHist(const char * name, const struct LatencyHist * hist)
+{
+	printf(" %s_p50_s=%.1f %s_p90_s=%.1f %s_p99_s=%.1f %s_max_s=%.1f",
+		name, seconds(elevator_latency_percentile(hist, 50)),
+		name, seconds(elevator_latency_percentile(hist, 90)),
+		name, seconds(elevator_latency_percentile(hist, 99)),
+		name, seconds(hist->max));
+}
+
+/*
+Runs a workload through one car in virtual time and prints one result line.
+Usage: ./elevator_sim.x workload|- [sched] [fifo|fill] [floors] [max_pass] [max_weight]
+*/
+
+int main(int argc, char ** argv)
+{
+	struct elevator_sched_ops * ops;
+	struct RunStats stats;
+	struct Arrival * list;
+	FILE * in;
+	Car car;
+	long count;
+	long t0;
+	double hours;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s workload|- [sched] [fifo|fill] [floors] [max_pass] [max_weight]\n", argv[0]);
+		return 1;
+	}
+
+	ops = elevator_find_sched((argc > 2) ? argv[2] : "scan");
+	fillBoarding = (argc > 3) && (strcmp(argv[3], "fill") == 0);
+	numFloors = (argc > 4) ? atoi(argv[4]) : MAX_FLOOR;
+	maxPass = (argc > 5) ? atoi(argv[5]) : MAX_PASS;
+	maxWeight = (argc > 6) ? atoi(argv[6]) : MAX_WEIGHT;
+
+	if ((ops == NULL) || (numFloors < 2) || (maxPass < 2) || (maxWeight < 40))
+	{
+		fprintf(stderr, "%s: bad policy or building\n", argv[0]);
+		return 1;
+	}
+
+	in = (strcmp(argv[1], "-") == 0) ? stdin : fopen(argv[1], "r");
+
+	if (in == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+
+	count = readWorkload(in, &list);
+
+	if ((count < 0) || (elevator_latency_init() != 0) || (elevator_user_init(&car, ops) != 0))
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	t0 = wallNs();
+
+	elevator_user_run(&car, list, count, 0, &stats);
+
+	hours = (double) stats.end / NSEC_PER_SEC / 3600;
+
+	printf("policy=%s boarding=%s floors=%d max_pass=%d max_weight=%d requests=%ld rejected=%ld delivered=%ld"
+		" sim_hours=%.2f per_hour=%.1f floors_travelled=%ld stops=%ld utilization=%.3f",
+		ops->name, fillBoarding ? "fill" : "fifo", numFloors, maxPass, maxWeight, stats.issued,
+		stats.rejected, stats.delivered, hours, (hours > 0) ? stats.delivered / hours : 0.0,
+		car.elevator.stats.floorsLoaded + car.elevator.stats.floorsEmpty, stats.stops,
+		(stats.end > 0) ? (double) stats.busy / stats.end : 0.0);
+	printHist("wait", &latencyStats.all.wait);
+	printHist("trip", &latencyStats.all.trip);
+	printf(" wall_ms=%ld\n", (wallNs() - t0) / 1000000);
+
+	elevator_user_exit(&car);
+	elevator_latency_exit();
+	free(list);
+
+	return 0;
+}
@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elevator_user.h"
+#include "elevator_latency.h"
+
+#define TEST_HOURS 4
+#define TEST_RATE 6	// Requests a minute
+#define STOP_HOURS 1	// When stopCase calls stop_elevator
+#define STOP_SECONDS 120	// Longest a car may take to drop everyone off after the stop call
+
+struct Profile
+{
+	const char * name;
+	int fromLobby;		// Percent of requests starting on floor 1
+	int toLobby;		// Percent of requests going to floor 1
+};
+
+static const struct Profile profiles[] =
+{
+	{ "uniform", 0, 0 },
+	{ "up", 90, 0 },
+	{ "down", 0, 90 },
+};
+
+// Longest wait, in seconds, each policy may leave anyone waiting under TEST_RATE
+static const struct
+{
+	const char * name;
+	int maxWait;
+} waitBounds[] =
+{
+	{ "scan", 180 },
+	{ "look", 180 },
+	{ "clook", 180 },
+	{ "nearest", 240 },
+	{ "dest", 300 },
+};
+
+/*
+Fills list with count requests at TEST_RATE a minute following a profile, from a fixed seed
+so every run is the same.
+*/
+
+static void makeWorkload(struct Arrival * list, long count, const struct Profile * profile)
+{
+	unsigned int seed = 4321;
+	u64 gap = 60 * NSEC_PER_SEC / TEST_RATE;
+	u64 time = 0;
+	long i;
+	int roll;
+
+	for (i = 0; i < count; i++)
+	{
+		time += (u64) (rand_r(&seed) % 2001) * gap / 1000;	// Averages gap
+		roll = rand_r(&seed) % 100;
+
+		list[i].time = time;
+		list[i].type = rand_r(&seed) % BELLHOP + 1;
+		list[i].start = rand_r(&seed) % numFloors + 1;
+		list[i].dest = rand_r(&seed) % numFloors + 1;
+
+		if (roll < profile->fromLobby)
+		{
+			list[i].start = 1;
+		}
+		else if (roll < profile->toLobby)
+		{
+			list[i].dest = 1;
+		}
+
+		while (list[i].dest == list[i].start)
+		{
+			list[i].dest = rand_r(&seed) % numFloors + 1;
+		}
+	}
+}
+
+static int waitBound(const char * name)
+{
+	int i;
+
+	for (i = 0; i < sizeof(waitBounds) / sizeof(waitBounds[0]); i++)
+	{
+		if (strcmp(waitBounds[i].name, name) == 0)
+		{
+			return waitBounds[i].maxWait;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Runs one workload through one car and checks that everyone was delivered, nobody waited
+longer than the policy's bound and the car never held more than its limits. Prints one
+PASS or FAIL line and returns true if it passed.
+*/
+
+static int runCase(struct elevator_sched_ops * ops, int fill, const struct Profile * profile,
+	struct Arrival * list, long count)
+{
+	struct RunStats stats;
+	Car car;
+	u64 maxWait;
+	int bound = waitBound(ops->name);
+	const char * failed = NULL;
+
+	fillBoarding = fill;
+	makeWorkload(list, count, profile);
+	elevator_latency_reset();
+
+	if (elevator_user_init(&car, ops) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	elevator_user_run(&car, list, count, 0, &stats);
+	maxWait = latencyStats.all.wait.max / USEC_PER_SEC;
+
+	if ((stats.issued != count) || (stats.delivered != stats.issued) || (car.queue.size != 0) ||
+	    (car.elevator.size != 0))
+	{
+		failed = "not everyone was delivered";
+	}
+	else if (stats.overloads != 0)
+	{
+		failed = "car held more than max_pass or max_weight";
+	}
+	else if ((bound == 0) || (maxWait > bound))
+	{
+		failed = "someone waited too long";
+	}
+
+	printf("%s policy=%s boarding=%s profile=%s delivered=%ld/%ld overloads=%ld wait_max_s=%llu bound_s=%d%s%s\n",
+		(failed == NULL) ? "PASS" : "FAIL", ops->name, fill ? "fill" : "fifo", profile->name,
+		stats.delivered, count, stats.overloads, (unsigned long long) maxWait, bound,
+		(failed == NULL) ? "" : ": ", (failed == NULL) ? "" : failed);
+
+	elevator_user_exit(&car);
+
+	return failed == NULL;
+}
+
+/*
+Queues a car load of adults on floor 1 and then two room service passengers behind them,
+with room service given a priority, and checks that room service is taken on the first trip
+rather than left for the car to come back for. Prints one PASS or FAIL line and returns true
+if it passed.
+*/
+
+static int priorityCase(struct elevator_sched_ops * ops, int fill)
+{
+	struct Arrival list[MAX_PASS + 2];
+	struct RunStats stats;
+	Car car;
+	long count = 0;
+	u64 adultWait, serviceWait;
+	int i;
+
+	for (i = 0; i < MAX_PASS; i++)
+	{
+		list[count++] = (struct Arrival) { 0, 1, 1, numFloors };	// Adults, one unit each
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		list[count++] = (struct Arrival) { 0, 3, 1, numFloors };	// Room service
+	}
+
+	fillBoarding = fill;
+	typePriority[2] = 2;
+	elevator_latency_reset();
+
+	if (elevator_user_init(&car, ops) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	elevator_user_run(&car, list, count, 0, &stats);
+	adultWait = latencyStats.type[0].wait.max / USEC_PER_SEC;
+	serviceWait = latencyStats.type[2].wait.max / USEC_PER_SEC;
+	typePriority[2] = 0;
+
+	printf("%s policy=%s boarding=%s priority delivered=%ld/%ld adult_wait_max_s=%llu service_wait_max_s=%llu%s\n",
+		((stats.delivered == count) && (serviceWait < adultWait)) ? "PASS" : "FAIL", ops->name,
+		fill ? "fill" : "fifo", stats.delivered, count, (unsigned long long) adultWait,
+		(unsigned long long) serviceWait, (serviceWait < adultWait) ? "" : ": room service was left behind");
+
+	elevator_user_exit(&car);
+
+	return (stats.delivered == count) && (serviceWait < adultWait);
+}
+
+/*
+Calls stop_elevator part way through the uniform workload and checks that the car drops off
+everyone aboard, boards nobody else and finishes within STOP_SECONDS, leaving whoever was
+still waiting in the queue. Prints one PASS or FAIL line and returns true if it passed.
+*/
+
+static int stopCase(struct elevator_sched_ops * ops, struct Arrival * list, long count)
+{
+	struct RunStats stats;
+	Car car;
+	u64 stopAt = (u64) STOP_HOURS * 3600 * NSEC_PER_SEC;
+	u64 after;
+	const char * failed = NULL;
+
+	fillBoarding = 0;
+	makeWorkload(list, count, &profiles[0]);
+	elevator_latency_reset();
+
+	if (elevator_user_init(&car, ops) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	elevator_user_run(&car, list, count, stopAt, &stats);
+	after = (stats.end - stopAt) / NSEC_PER_SEC;
+
+	if ((car.elevator.size != 0) || (car.elevator.passUnit != 0))
+	{
+		failed = "someone was left aboard";
+	}
+	else if ((stats.lateBoards != 0) || (stats.issued >= count) ||
+	         (stats.delivered + car.queue.size != stats.issued))
+	{
+		failed = "someone boarded after the stop call";
+	}
+	else if ((stats.end < stopAt) || (after > STOP_SECONDS))
+	{
+		failed = "the car took too long to stop";
+	}
+
+	printf("%s policy=%s stop delivered=%ld/%ld left_waiting=%d stop_after_s=%llu%s%s\n",
+		(failed == NULL) ? "PASS" : "FAIL", ops->name, stats.delivered, stats.issued,
+		car.queue.size, (unsigned long long) after, (failed == NULL) ? "" : ": ",
+		(failed == NULL) ? "" : failed);
+
+	elevator_user_exit(&car);
+
+	return failed == NULL;
+}
+
+/*
+Runs every policy and boarding mode over each traffic profile in a 10 floor building, and
+checks each of them boards by priority and stops cleanly. Exits with 1 if any case failed.
+*/
+
+int main(int argc, char ** argv)
+{
+	long count = TEST_HOURS * 60 * TEST_RATE;
+	struct Arrival * list = calloc(count, sizeof(*list));
+	int passed = 0, cases = 0;
+	int i, j, fill;
+
+	if ((list == NULL) || (elevator_latency_init() != 0))
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+	{
+		for (j = 0; schedPolicies[j] != NULL; j++)
+		{
+			for (fill = 0; fill <= 1; fill++)
+			{
+				passed += runCase(schedPolicies[j], fill, &profiles[i], list, count);
+				cases++;
+			}
+		}
+	}
+
+	for (j = 0; schedPolicies[j] != NULL; j++)
+	{
+		for (fill = 0; fill <= 1; fill++)
+		{
+			passed += priorityCase(schedPolicies[j], fill);
+			cases++;
+		}
+	}
+
+	for (j = 0; schedPolicies[j] != NULL; j++)
+	{
+		passed += stopCase(schedPolicies[j], list, count);
+		cases++;
+	}
+
+	printf("%d of %d passed\n", passed, cases);
+
+	elevator_latency_exit();
+	free(list);
+
+	return (passed == cases) ? 0 : 1;
+}
@@ -0,0 +1,361 @@
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/bitmap.h>
+#include <linux/ktime.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_car.h"
+#include "elevator_ticket.h"
+#include "elevator_admit.h"
+#include "elevator_user.h"
+
+// The module parameters elevator_sched.c reads, at their defaults. Callers may change them
+// before setting up a car
+int numFloors = MAX_FLOOR;
+int maxPass = MAX_PASS;
+int maxWeight = MAX_WEIGHT;
+int numCars = 1;
+struct Car * cars;
+
+int fillBoarding;
+int boardSkipMax = 3;
+int typePriority[BELLHOP];
+int priorityAging = 30;
+int waitTarget[BELLHOP];
+
+u64 (*elevator_user_clock)(void);	// ktime_get_ns reads this instead of the real clock if set
+
+static int typePass[BELLHOP] = {1, 1, 2, 2};
+static int typeWeight[BELLHOP] = {10, 5, 20, 40};
+
+// Passengers freePassenger has been handed back, for elevator_user_passenger to reuse
+static struct list_head freed = LIST_HEAD_INIT(freed);
+
+/**************************************************************************************************/
+
+/*
+Tickets and admission control need the system calls, so there is nothing for these to do.
+*/
+
+void elevator_ticket_update(Passenger * passenger, int event, u64 now)
+{
+}
+
+void elevator_admit_leave(int start)
+{
+}
+
+void freePassenger(Passenger * passenger)
+{
+	list_add_tail(&passenger->list, &freed);
+}
+
+/*
+Returns a passenger that Unload has dropped off, or NULL if there are none.
+*/
+
+static Passenger * elevator_user_freed(void)
+{
+	Passenger * p;
+
+	if (list_empty(&freed))
+	{
+		return NULL;
+	}
+
+	p = list_first_entry(&freed, Passenger, list);
+	list_del(&p->list);
+
+	return p;
+}
+
+/*
+Returns a new passenger of the given type, issued now. Returns NULL if it could not be
+allocated.
+*/
+
+Passenger * elevator_user_passenger(int type, int start, int dest)
+{
+	Passenger * p = elevator_user_freed();
+
+	if (p == NULL)
+	{
+		p = kmalloc(sizeof(*p), GFP_KERNEL);
+
+		if (p == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	memset(p, 0, sizeof(*p));
+	p->passUnit = typePass[type - 1];
+	p->weightUnit = typeWeight[type - 1];
+	p->start = start;
+	p->dest = dest;
+	p->type = type;
+	p->issueTime = ktime_get_ns();
+	p->priority = typePriority[type - 1];
+	INIT_LIST_HEAD(&p->list);
+
+	return p;
+}
+
+/*
+Hands a passenger to a car the way the system calls do, on its arrivals list. The car's
+steps move them onto their floor queue.
+*/
+
+void elevator_user_queue(Car * car, Passenger * p)
+{
+	llist_add(&p->node, &car->arrivals);
+}
+
+static void freeQueue(struct list_head * list)
+{
+	while (!list_empty(list))
+	{
+		Passenger * p = list_first_entry(list, Passenger, list);
+
+		list_del(&p->list);
+		kfree(p);
+	}
+}
+
+/*
+Sets up an empty, idle car on floor 1 running the given policy, with its per floor arrays
+allocated for numFloors floors. Returns -ENOMEM if they could not be.
+*/
+
+int elevator_user_init(Car * car, struct elevator_sched_ops * ops)
+{
+	memset(car, 0, sizeof(*car));
+
+	if (allocFloors(car) != 0)
+	{
+		freeFloors(car);
+		memset(car, 0, sizeof(*car));
+		return -ENOMEM;
+	}
+
+	mutex_init(&car->elevatorMutex);
+	mutex_init(&car->queueMutex);
+	car->ops = ops;
+	car->elevator.state = IDLE;
+	car->elevator.currFloor = 1;
+	car->elevator.destFloor = 1;
+	init_llist_head(&car->arrivals);
+
+	if (elevator_sched_init(car) != 0)
+	{
+		elevator_user_exit(car);
+		return -ENOMEM;
+	}
+
+	if (car->ops->attach != NULL)
+	{
+		car->ops->attach(car);
+	}
+
+	return 0;
+}
+
+/*
+Frees a car set up by elevator_user_init, and every passenger still in it.
+*/
+
+void elevator_user_exit(Car * car)
+{
+	int i;
+
+	drainArrivals(car);	// So they are freed with the rest
+
+	for (i = 0; i < numFloors; i++)
+	{
+		freeQueue(&car->elevator.list[i]);
+		freeQueue(&car->queue.up[i]);
+		freeQueue(&car->queue.down[i]);
+	}
+
+	elevator_sched_exit(car);
+	freeFloors(car);
+
+	memset(car, 0, sizeof(*car));
+}
+
+/**************************************************************************************************/
+
+static u64 userNow;	// The virtual clock of elevator_user_run
+
+static u64 userClock(void)
+{
+	return userNow;
+}
+
+// The run elevator_user_run is making, for the hooks
+static const struct Arrival * userList;
+static long userNext;
+static long userCount;
+static u64 userIdle;		// Nanoseconds spent idle
+static u64 userStop;		// When stop_elevator is called, 0 for never
+static struct RunStats * userStats;
+
+static int userStopCalled(void)
+{
+	return (userStop != 0) && (userNow >= userStop);
+}
+
+/*
+Hands the car every request that has arrived by now, issued at its own arrival time.
+*/
+
+static void queueArrivals(Car * car)
+{
+	const struct Arrival * a;
+	Passenger * p;
+
+	for (; (userNext < userCount) && (userList[userNext].time <= userNow); userNext++)
+	{
+		a = &userList[userNext];
+
+		if ((a->type < 1) || (a->type > BELLHOP) || (a->start < 1) || (a->start > numFloors) ||
+		    (a->dest < 1) || (a->dest > numFloors) || (a->start == a->dest))
+		{
+			userStats->rejected++;
+			continue;
+		}
+
+		p = elevator_user_passenger(a->type, a->start, a->dest);
+
+		if (p == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+
+		p->issueTime = a->time;
+		elevator_user_queue(car, p);
+		userStats->issued++;
+	}
+}
+
+/*
+runCar hooks for a run in virtual time. The run stops at the stop call, if there is one, or
+once every request has come in and been delivered. Dwelling and travelling move the clock
+on, taking in the requests that arrive meanwhile as Elevator_Wait does, and an idle car skips
+straight to the next arrival. As in the module, the stop call cuts short any wait but those
+made while draining, and nothing cuts draining short.
+*/
+
+static int userStopping(Car * car, int draining)
+{
+	if (draining)
+	{
+		return 0;
+	}
+
+	return userStopCalled() || ((userNext >= userCount) && llist_empty(&car->arrivals) &&
+		(car->queue.size == 0) && (car->elevator.passUnit == 0));
+}
+
+static int userWait(Car * car, int seconds, int draining)
+{
+	u64 until = userNow + (u64) seconds * NSEC_PER_SEC;
+	int stopped = (!draining) && (userStop != 0) && (userStop < until);
+
+	userNow = stopped ? max(userNow, userStop) : until;
+	queueArrivals(car);
+
+	mutex_lock(&car->queueMutex);
+	drainArrivals(car);
+	mutex_unlock(&car->queueMutex);
+
+	return stopped;
+}
+
+static void userIdleUntil(Car * car)
+{
+	u64 until = userNow;
+
+	if (userNext < userCount)
+	{
+		until = max(until, userList[userNext].time);
+	}
+
+	if ((userStop != 0) && (userStop < until))	// The stop call wakes it first
+	{
+		until = max(userNow, userStop);
+	}
+
+	userIdle += until - userNow;
+	userNow = until;
+
+	queueArrivals(car);
+}
+
+static void userServed(Car * car, int draining, int loadPass, int unloadPass)
+{
+	userStats->delivered += unloadPass;
+
+	if (userStopCalled())
+	{
+		userStats->lateBoards += loadPass;
+	}
+
+	if ((car->elevator.passUnit > maxPass) || (car->elevator.weightUnit > maxWeight))
+	{
+		userStats->overloads++;
+	}
+
+	if (loadPass + unloadPass > 0)
+	{
+		userStats->stops++;
+	}
+}
+
+static void userChose(Car * car, int draining, int from)
+{
+}
+
+static void userArrived(Car * car)
+{
+}
+
+static const struct CarHooks userHooks =
+{
+	.stopping = userStopping,
+	.wait = userWait,
+	.idle = userIdleUntil,
+	.served = userServed,
+	.chose = userChose,
+	.arrived = userArrived,
+};
+
+/*
+Runs a car with runCar, the loop the module's car threads run, in virtual time until every
+request in list, which is sorted by arrival time, has been delivered, or if stopAt is not 0
+until a stop call then until everyone aboard is off. ktime_get_ns reads the virtual clock
+meanwhile, so board times, priority aging and the latency histograms all use it.
+*/
+
+void elevator_user_run(Car * car, const struct Arrival * list, long count, u64 stopAt, struct RunStats * stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	userNow = 0;
+	userIdle = 0;
+	userStop = stopAt;
+	userList = list;
+	userNext = 0;
+	userCount = count;
+	userStats = stats;
+	elevator_user_clock = userClock;
+
+	queueArrivals(car);
+	runCar(car, &userHooks);
+
+	stats->end = userNow;
+	stats->busy = userNow - userIdle;
+	elevator_user_clock = NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef __ELEVATOR_USER
+#define __ELEVATOR_USER
+
+#include "elevator.h"
+#include "elevator_sched.h"
+
+/*
+Userspace build of the elevator core. elevator_car.c, elevator_sched.c and elevator_latency.c
+are compiled as they are against the kernel shims in shim/, and this file stands in for the
+parts of the module around them: the module parameters, the passenger pool, setting up a
+car, and hooks that run the car's loop, runCar, in virtual time.
+*/
+
+struct Arrival
+{
+	u64 time;	// Nanoseconds from the start of the run
+	int type;
+	int start;
+	int dest;
+};
+
+struct RunStats
+{
+	long issued;
+	long rejected;		// Bad type or floors, as issue_request would turn away
+	long delivered;
+	long stops;		// Times the car loaded or unloaded
+	long overloads;		// Stops that left more aboard than max_pass or max_weight
+	long lateBoards;	// Passengers boarded after the stop call
+	u64 busy;		// Nanoseconds not IDLE
+	u64 end;		// Nanoseconds from the start to the last drop off
+};
+
+int elevator_user_init(Car * car, struct elevator_sched_ops * ops);
+void elevator_user_exit(Car * car);
+Passenger * elevator_user_passenger(int type, int start, int dest);
+void elevator_user_queue(Car * car, Passenger * p);
+void elevator_user_run(Car * car, const struct Arrival * list, long count, u64 stopAt, struct RunStats * stats);
+
+#endif
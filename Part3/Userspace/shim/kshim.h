@@ -0,0 +1,360 @@
+#ifndef __ELEVATOR_KSHIM
+#define __ELEVATOR_KSHIM
+
+/*
+Just enough of the kernel API for elevator_car.c, elevator_sched.c and elevator_latency.c to
+build as plain userspace C. Every <linux/...> header the elevator core includes is a one line file in
+shim/linux that pulls this in. Locks are pthread mutexes, allocations are malloc, and the
+tracepoints compile to nothing.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef uint32_t __u32;
+typedef uint64_t __u64;
+typedef unsigned int gfp_t;
+
+#define __user
+#define GFP_KERNEL 0
+#define GFP_NOWAIT 0
+
+#define EXPORT_SYMBOL(sym) extern int __kshim_export
+#define MODULE_LICENSE(text) extern int __kshim_export
+#define MODULE_DESCRIPTION(text) extern int __kshim_export
+
+#define KERN_ERR ""
+#define KERN_WARNING ""
+#define KERN_NOTICE ""
+#define KERN_ALERT ""
+#define printk(...) fprintf(stderr, __VA_ARGS__)
+
+#define WARN_ON(cond) ({ int __warn = !!(cond); if (__warn) fprintf(stderr, "WARN_ON %s:%d\n", __FILE__, __LINE__); __warn; })
+
+#define READ_ONCE(x) (*(volatile typeof(x) *) &(x))
+#define WRITE_ONCE(x, v) (*(volatile typeof(x) *) &(x) = (v))
+
+#define min(a, b) ({ typeof(a) __a = (a); typeof(b) __b = (b); __a < __b ? __a : __b; })
+#define max(a, b) ({ typeof(a) __a = (a); typeof(b) __b = (b); __a > __b ? __a : __b; })
+#define min3(a, b, c) min(min(a, b), c)
+#define min_t(type, a, b) min((type) (a), (type) (b))
+#define max_t(type, a, b) max((type) (a), (type) (b))
+
+#define container_of(ptr, type, member) ((type *) ((char *) (ptr) - offsetof(type, member)))
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_USEC 1000ULL
+#define USEC_PER_MSEC 1000ULL
+#define USEC_PER_SEC 1000000ULL
+
+static inline u64 div_u64(u64 dividend, u32 divisor)
+{
+	return dividend / divisor;
+}
+
+static inline int ilog2(u64 n)
+{
+	return 63 - __builtin_clzll(n);
+}
+
+extern u64 (*elevator_user_clock)(void);	// Virtual clock, if set, in elevator_user.c
+
+static inline u64 ktime_get_ns(void)
+{
+	struct timespec ts;
+
+	if (elevator_user_clock != NULL)
+	{
+		return elevator_user_clock();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u64) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/**************************************************************************************************/
+
+static inline void * kmalloc(size_t size, gfp_t flags) { return malloc(size); }
+static inline void * kzalloc(size_t size, gfp_t flags) { return calloc(1, size); }
+static inline void * kcalloc(size_t n, size_t size, gfp_t flags) { return calloc(n, size); }
+static inline void * kmalloc_array(size_t n, size_t size, gfp_t flags) { return calloc(n, size); }
+static inline void * kvmalloc(size_t size, gfp_t flags) { return malloc(size); }
+static inline void * kvcalloc(size_t n, size_t size, gfp_t flags) { return calloc(n, size); }
+static inline void kfree(const void * p) { free((void *) p); }
+static inline void kvfree(const void * p) { free((void *) p); }
+
+/**************************************************************************************************/
+
+typedef struct { pthread_mutex_t lock; } spinlock_t;
+struct mutex { pthread_mutex_t lock; };
+
+#define DEFINE_SPINLOCK(name) spinlock_t name = { PTHREAD_MUTEX_INITIALIZER }
+#define DEFINE_MUTEX(name) struct mutex name = { PTHREAD_MUTEX_INITIALIZER }
+
+static inline void spin_lock_init(spinlock_t * l) { pthread_mutex_init(&l->lock, NULL); }
+static inline void spin_lock(spinlock_t * l) { pthread_mutex_lock(&l->lock); }
+static inline void spin_unlock(spinlock_t * l) { pthread_mutex_unlock(&l->lock); }
+static inline void mutex_init(struct mutex * m) { pthread_mutex_init(&m->lock, NULL); }
+static inline void mutex_lock(struct mutex * m) { pthread_mutex_lock(&m->lock); }
+static inline void mutex_unlock(struct mutex * m) { pthread_mutex_unlock(&m->lock); }
+static inline void mutex_destroy(struct mutex * m) { pthread_mutex_destroy(&m->lock); }
+
+typedef struct { unsigned int sequence; spinlock_t lock; } seqlock_t;
+typedef struct { int unused; } wait_queue_head_t;
+
+typedef struct { int counter; } atomic_t;
+typedef struct { long counter; } atomic_long_t;
+
+static inline int atomic_read(const atomic_t * v) { return __atomic_load_n(&v->counter, __ATOMIC_RELAXED); }
+static inline void atomic_set(atomic_t * v, int i) { __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED); }
+static inline void atomic_add(int i, atomic_t * v) { __atomic_add_fetch(&v->counter, i, __ATOMIC_SEQ_CST); }
+static inline void atomic_sub(int i, atomic_t * v) { __atomic_sub_fetch(&v->counter, i, __ATOMIC_SEQ_CST); }
+static inline void atomic_inc(atomic_t * v) { atomic_add(1, v); }
+static inline void atomic_dec(atomic_t * v) { atomic_sub(1, v); }
+
+struct task_struct;
+struct eventfd_ctx;
+
+/**************************************************************************************************/
+
+struct list_head
+{
+	struct list_head * next;
+	struct list_head * prev;
+};
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+
+static inline void INIT_LIST_HEAD(struct list_head * list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head * entry, struct list_head * prev, struct list_head * next)
+{
+	next->prev = entry;
+	entry->next = next;
+	entry->prev = prev;
+	prev->next = entry;
+}
+
+static inline void list_add(struct list_head * entry, struct list_head * head)
+{
+	__list_add(entry, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head * entry, struct list_head * head)
+{
+	__list_add(entry, head->prev, head);
+}
+
+static inline void list_del(struct list_head * entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline void list_move_tail(struct list_head * entry, struct list_head * head)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	list_add_tail(entry, head);
+}
+
+static inline int list_empty(const struct list_head * head)
+{
+	return head->next == head;
+}
+
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+#define list_for_each(pos, head) for (pos = (head)->next; pos != (head); pos = pos->next)
+#define list_for_each_safe(pos, n, head) \
+	for (pos = (head)->next, n = pos->next; pos != (head); pos = n, n = pos->next)
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_entry((head)->next, typeof(*pos), member); &pos->member != (head); \
+	     pos = list_entry(pos->member.next, typeof(*pos), member))
+
+struct llist_node { struct llist_node * next; };
+struct llist_head { struct llist_node * first; };
+
+#define llist_entry(ptr, type, member) container_of(ptr, type, member)
+
+static inline void init_llist_head(struct llist_head * list) { list->first = NULL; }
+static inline bool llist_empty(const struct llist_head * head) { return head->first == NULL; }
+
+static inline bool llist_add(struct llist_node * node, struct llist_head * head)	// One thread only
+{
+	node->next = head->first;
+	head->first = node;
+
+	return node->next == NULL;
+}
+
+static inline struct llist_node * llist_del_all(struct llist_head * head)
+{
+	struct llist_node * first = head->first;
+
+	head->first = NULL;
+
+	return first;
+}
+
+static inline struct llist_node * llist_reverse_order(struct llist_node * head)
+{
+	struct llist_node * reversed = NULL;
+	struct llist_node * next;
+
+	while (head != NULL)
+	{
+		next = head->next;
+		head->next = reversed;
+		reversed = head;
+		head = next;
+	}
+
+	return reversed;
+}
+
+/**************************************************************************************************/
+
+#define BITS_PER_LONG (8 * (int) sizeof(long))
+#define BITS_TO_LONGS(nbits) (((nbits) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define BIT_WORD(nr) ((nr) / BITS_PER_LONG)
+#define BIT_MASK(nr) (1UL << ((nr) % BITS_PER_LONG))
+
+static inline unsigned long * bitmap_zalloc(unsigned int nbits, gfp_t flags)
+{
+	return calloc(BITS_TO_LONGS(nbits), sizeof(unsigned long));
+}
+
+static inline void bitmap_free(const unsigned long * bitmap) { free((void *) bitmap); }
+
+static inline void __set_bit(int nr, unsigned long * addr) { addr[BIT_WORD(nr)] |= BIT_MASK(nr); }
+static inline void __clear_bit(int nr, unsigned long * addr) { addr[BIT_WORD(nr)] &= ~BIT_MASK(nr); }
+static inline int test_bit(int nr, const unsigned long * addr) { return (addr[BIT_WORD(nr)] & BIT_MASK(nr)) != 0; }
+
+static inline void bitmap_zero(unsigned long * dst, unsigned int nbits)
+{
+	memset(dst, 0, BITS_TO_LONGS(nbits) * sizeof(unsigned long));
+}
+
+static inline void bitmap_copy(unsigned long * dst, const unsigned long * src, unsigned int nbits)
+{
+	memcpy(dst, src, BITS_TO_LONGS(nbits) * sizeof(unsigned long));
+}
+
+static inline void bitmap_or(unsigned long * dst, const unsigned long * a, const unsigned long * b, unsigned int nbits)
+{
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(nbits); i++)
+	{
+		dst[i] = a[i] | b[i];
+	}
+}
+
+static inline int bitmap_andnot(unsigned long * dst, const unsigned long * a, const unsigned long * b, unsigned int nbits)
+{
+	unsigned long any = 0;
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(nbits); i++)
+	{
+		dst[i] = a[i] & ~b[i];
+		any |= dst[i];
+	}
+
+	return any != 0;
+}
+
+static inline void bitmap_clear(unsigned long * map, unsigned int start, unsigned int len)
+{
+	while (len-- > 0)
+	{
+		__clear_bit(start++, map);
+	}
+}
+
+static inline unsigned long find_next_bit(const unsigned long * addr, unsigned long size, unsigned long offset)
+{
+	unsigned long word;
+
+	if (offset >= size)
+	{
+		return size;
+	}
+
+	word = addr[BIT_WORD(offset)] & (~0UL << (offset % BITS_PER_LONG));
+	offset -= offset % BITS_PER_LONG;
+
+	while (word == 0)
+	{
+		offset += BITS_PER_LONG;
+
+		if (offset >= size)
+		{
+			return size;
+		}
+
+		word = addr[BIT_WORD(offset)];
+	}
+
+	return min(offset + __builtin_ctzl(word), size);
+}
+
+static inline unsigned long find_first_bit(const unsigned long * addr, unsigned long size)
+{
+	return find_next_bit(addr, size, 0);
+}
+
+static inline unsigned long find_last_bit(const unsigned long * addr, unsigned long size)
+{
+	unsigned long i = size;
+
+	while (i-- > 0)
+	{
+		if (test_bit(i, addr))
+		{
+			return i;
+		}
+	}
+
+	return size;
+}
+
+static inline int bitmap_empty(const unsigned long * addr, unsigned int nbits)
+{
+	return find_first_bit(addr, nbits) >= nbits;
+}
+
+#define for_each_set_bit(bit, addr, size) \
+	for ((bit) = find_first_bit((addr), (size)); (bit) < (size); (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+/**************************************************************************************************/
+
+#define TP_PROTO(args...) args
+#define TP_ARGS(args...) args
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print) static inline void trace_##name(proto) { }
+#define DECLARE_EVENT_CLASS(name, proto, args, tstruct, assign, print)
+#define DEFINE_EVENT(template, name, proto, args) static inline void trace_##name(proto) { }
+
+#endif
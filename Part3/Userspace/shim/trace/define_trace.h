@@ -0,0 +1 @@
+/* Tracepoints compile to nothing in the userspace build, see kshim.h */
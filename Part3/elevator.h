@@ -2,6 +2,54 @@
 #define __ELEVATOR
 
 #include <linux/list.h>
+#include <linux/bitmap.h>
+#include <linux/llist.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/seqlock.h>
+#include <linux/atomic.h>
+
+// DEFINITIONS FOR ELEVATOR CONSTRAINTS, the defaults for the floors, max_pass and
+// max_weight module parameters
+#define MAX_PASS 10
+#define MAX_WEIGHT 150
+#define MAX_FLOOR 10
+#define MIN_FLOOR 1
+#define FLOOR_LIMIT 1024	// Most floors the floors parameter accepts
+#define CAR_LIMIT 64		// Most cars the cars parameter accepts
+
+// DEFINITIONS FOR PASSENGER TYPES
+#define ADULTS 1
+#define CHILD 2
+#define ROOM_SERVICE 3
+#define BELLHOP 4
+
+// ENUMERATIONS FOR ELEVATOR STATES
+#define OFFLINE 0
+#define IDLE 1
+#define LOADING 2
+#define UP 3
+#define DOWN 4
+#define NUM_STATES 5
+
+/*
+Running totals of how a car spends its time and travel, for judging how well a policy does
+and what it costs. Kept with the rest of the car's state under elevatorMutex.
+*/
+
+struct CarStats
+{
+	u64 stateTime[NUM_STATES];	// Nanoseconds spent in each state, up to stateSince
+	u64 stateSince;			// ktime_get_ns when the car entered its current state
+	long floorsLoaded;		// Floors travelled with passengers aboard
+	long floorsEmpty;		// and with nobody aboard
+	long stops;			// Arrivals at a floor
+	long uselessStops;		// Arrivals where nobody got on or off
+	u64 passFloors;			// Passenger units aboard times floors travelled, for the
+	u64 weightFloors;		// average load while moving, and the same for weight
+};
+
+typedef struct CarStats CarStats;
 
 struct Elevator
 {
@@ -12,31 +60,154 @@ struct Elevator
         int passUnit;
         int weightUnit;
         int stop_call;
-	int passServiced[10];
+	int * passServiced;		// Per floor arrays are numFloors long, allocated at init
 	int size;
-        struct list_head list[10];
+        struct list_head * list;
+	unsigned long * carCalls;	// Floors someone aboard is going to
+	CarStats stats;
 };
 
 typedef struct Elevator Elevator;
 
+struct Ticket;
+
 struct Passenger
 {
         int passUnit;
         int weightUnit;
         int start;
         int dest;
+	int type;
+	u64 issueTime;			// ktime_get_ns when the request was issued
+	u64 boardTime;			// and when the passenger boarded
+	struct Ticket * ticket;		// Set if issued with issue_ticket, until dropped off
+	int skipped;			// Times fill boarding left them for someone behind them
+	int priority;			// Their type's type_priority when the request was issued
+	int cancelled;			// Cancelled while still on the arrivals list, so never queued
         struct list_head list;
+	struct list_head typeList;	// Link on the queue for their type on their floor, see upType
+	struct llist_node node;		// Link on the arrivals list until the elevator thread queues it
 };
 
 typedef struct Passenger Passenger;
 
+// Most requests one issue_requests call takes
+#define ISSUE_BATCH_MAX 1024
+
+/*
+One record of the array passed to the issue_requests system call
+*/
+
+struct elevator_request
+{
+	int type;
+	int start;
+	int dest;
+};
+
+// Events wait_ticket waits for, ORed with ELEVATOR_TICKET_NOWAIT to only check
+#define ELEVATOR_TICKET_PICKUP 1
+#define ELEVATOR_TICKET_DROPOFF 2
+#define ELEVATOR_TICKET_NOWAIT 0x100
+
+struct PassengerStats
+{
+	int live;		// Passengers handed out and not yet unloaded
+	int livePeak;
+	int pooled;		// Passengers on the free list
+	int pooledPeak;
+	long slabAllocs;	// Passengers that came from the slab cache
+	long poolAllocs;	// Passengers reused from the free list
+};
+
+typedef struct PassengerStats PassengerStats;
+
+/*
+Snapshot of the elevator and floors that /proc/elevator formats its report from, with one
+FloorStatus per floor. Written by the module under statusLock, read locklessly with
+read_seqbegin/read_seqretry.
+*/
+
+struct FloorStatus
+{
+	int passUnit;		// Load waiting on the floor
+	int weightUnit;
+	int serviced;		// Passengers dropped off at the floor
+};
+
+struct ElevatorStatus
+{
+	int state;
+	int heading;		// UP or DOWN while moving or loading, IDLE otherwise
+	int currFloor;
+	int destFloor;
+	int passUnit;
+	int weightUnit;
+	const char * policy;	// Name of the scheduling policy
+	CarStats stats;
+	int maxPass;		// Car limits, so readers need not reach into elevator_main.c
+	int maxWeight;
+	int floors;		// Number of entries in floor
+	struct FloorStatus floor[];
+};
+
+#define STATUS_SIZE(floors) (sizeof(struct ElevatorStatus) + (floors) * sizeof(struct FloorStatus))
+
 struct Queue
 {
-        struct list_head list[10];
+        struct list_head * up;		// Passengers waiting on each floor to go up
+        struct list_head * down;	// Passengers waiting on each floor to go down
         int size;
-	int floorSize[10];
+	int * floorSize;	// Per floor arrays are numFloors long, allocated at init
+	int * upSize;
+	int * downSize;
+	int passUnit;		// Load waiting in the whole building
+	int weightUnit;
+	int * floorPass;	// Load waiting on each floor
+	int * floorWeight;
+	int * upPass;		// Load waiting on each floor to go up
+	int * upWeight;
+	int * downPass;		// Load waiting on each floor to go down
+	int * downWeight;
+	unsigned long * hallCalls;	// Floors with someone waiting
+	struct list_head * upType;	// The same passengers again, one queue per type on each floor in
+	struct list_head * downType;	// the order they arrived, numFloors * BELLHOP long
+	int * priorityWaiting;		// Passengers waiting on each floor with a priority above 0
+	unsigned long * priorityCalls;	// and the floors where there are any
 };
 
 typedef struct Queue Queue;
 
+struct elevator_sched_ops;
+struct FillItem;
+
+/*
+One car of the elevator bank. Each car has its own elevator thread and locks, and its own
+queue of the hall calls the dispatcher gave it.
+*/
+
+struct Car
+{
+	int id;
+	Elevator elevator;
+	Queue queue;
+	struct mutex elevatorMutex;
+	struct mutex queueMutex;
+	wait_queue_head_t wait;		// The car's thread sleeps here while idle or moving
+	struct llist_head arrivals;	// Passengers handed to the car and not yet queued
+	atomic_t assigned;		// Passengers handed to the car and not yet dropped off
+	struct task_struct * thread;
+	struct elevator_sched_ops * ops;	// Scheduling policy the car is running
+	struct ElevatorStatus * status;	// Snapshot for /proc/elevator and the dispatcher
+	seqlock_t statusLock;
+	unsigned long * floorScratch;	// Used by the scheduling policies
+	unsigned long * refusedCalls;	// Hall calls nearest call first could board nobody at
+	int * destWaiting;
+	int * fillWeight;		// Fill boarding's knapsack, see fillFrom
+	struct FillItem * fillItem;
+	unsigned long * fillChoice;
+};
+
+typedef struct Car Car;
+
 #endif
@@ -0,0 +1,273 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/spinlock.h>
+#include <linux/hashtable.h>
+#include <linux/cred.h>
+#include <linux/uidgid.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/atomic.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_admit.h"
+
+// Limits on passengers waiting to be picked up, in the whole building and on any one start
+// floor, and on requests each user may issue per second. 0 turns a limit off
+static int queue_limit = 0;
+module_param(queue_limit, int, 0644);
+MODULE_PARM_DESC(queue_limit, "Most passengers waiting in the building, 0 for no limit");
+
+static int floor_limit = 0;
+module_param(floor_limit, int, 0644);
+MODULE_PARM_DESC(floor_limit, "Most passengers waiting on one floor, 0 for no limit");
+
+static int rate_limit = 0;
+module_param(rate_limit, int, 0644);
+MODULE_PARM_DESC(rate_limit, "Requests per second each user may issue, 0 for no limit");
+
+static int rate_burst = 10;
+module_param(rate_burst, int, 0644);
+MODULE_PARM_DESC(rate_burst, "Requests a user may issue at once before rate_limit applies");
+
+struct AdmitStats admitStats;
+EXPORT_SYMBOL(admitStats);
+
+static atomic_t * floorWaiting;	// Passengers waiting on each start floor, numFloors long
+
+/*
+Token bucket of one user. Tokens are kept in nanoseconds' worth of rate_limit, so a request
+costs NSEC_PER_SEC and every nanosecond adds rate_limit.
+*/
+
+struct UidBucket
+{
+	struct hlist_node node;
+	struct list_head idle;	// Link on idleBuckets
+	kuid_t uid;
+	u64 tokens;
+	u64 last;		// ktime_get_ns when the bucket was last topped up
+};
+
+static DEFINE_HASHTABLE(uidBuckets, 6);
+static LIST_HEAD(idleBuckets);		// Every bucket, least recently used first
+static DEFINE_SPINLOCK(bucketLock);
+
+/**************************************************************************************************/
+
+int elevator_admit_init(void)
+{
+	floorWaiting = kvcalloc(numFloors, sizeof(*floorWaiting), GFP_KERNEL);
+
+	if (floorWaiting == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	atomic_set(&admitStats.waiting, 0);
+	atomic_long_set(&admitStats.queueRejects, 0);
+	atomic_long_set(&admitStats.floorRejects, 0);
+	atomic_long_set(&admitStats.rateRejects, 0);
+
+	return 0;
+}
+
+void elevator_admit_exit(void)
+{
+	struct UidBucket * bucket;
+	struct hlist_node * tmp;
+	int i;
+
+	hash_for_each_safe(uidBuckets, i, tmp, bucket, node)
+	{
+		hash_del(&bucket->node);
+		kfree(bucket);
+	}
+
+	INIT_LIST_HEAD(&idleBuckets);
+	kvfree(floorWaiting);
+}
+
+static struct UidBucket * findBucket(kuid_t uid)
+{
+	struct UidBucket * bucket;
+
+	hash_for_each_possible(uidBuckets, bucket, node, __kuid_val(uid))
+	{
+		if (uid_eq(bucket->uid, uid))
+		{
+			return bucket;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+Takes buckets that have been idle for refill nanoseconds, long enough to have filled up
+again, out of the table and onto expired, for the caller to free once it lets go of
+bucketLock. Such a bucket is the same as the full one a new user starts with, so dropping it
+changes nothing, and users who stop issuing requests do not keep their bucket for good.
+*/
+
+static void expireBuckets(struct list_head * expired, u64 now, u64 refill)
+{
+	struct UidBucket * bucket;
+
+	while (!list_empty(&idleBuckets))
+	{
+		bucket = list_first_entry(&idleBuckets, struct UidBucket, idle);
+
+		if (now - bucket->last < refill)
+		{
+			break;
+		}
+
+		hash_del(&bucket->node);
+		list_move_tail(&bucket->idle, expired);
+	}
+}
+
+/*
+Takes a token from the calling user's bucket, topping it up for the time since the last
+request first. A new user starts with a full bucket of rate_burst tokens. Returns 0 if there
+was a token to take or there is no rate_limit, -EAGAIN if there was not, or -ENOMEM if a new
+user's bucket could not be allocated.
+*/
+
+static int takeToken(void)
+{
+	struct UidBucket * bucket;
+	struct UidBucket * fresh = NULL;
+	struct UidBucket * tmp;
+	LIST_HEAD(expired);
+	kuid_t uid = current_uid();
+	int rate = READ_ONCE(rate_limit);
+	u64 full = (u64) max(READ_ONCE(rate_burst), 1) * NSEC_PER_SEC;
+	u64 now = ktime_get_ns();
+	int ret = -EAGAIN;
+
+	if (rate <= 0)
+	{
+		return 0;
+	}
+
+	spin_lock(&bucketLock);
+
+	expireBuckets(&expired, now, div_u64(full, rate));
+	bucket = findBucket(uid);
+
+	if (bucket == NULL)	// First request from this user, so allocate outside the lock
+	{
+		spin_unlock(&bucketLock);
+
+		fresh = kzalloc(sizeof(*fresh), GFP_KERNEL);
+
+		spin_lock(&bucketLock);
+
+		bucket = findBucket(uid);
+
+		if ((bucket == NULL) && (fresh == NULL))
+		{
+			spin_unlock(&bucketLock);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		if (bucket == NULL)
+		{
+			bucket = fresh;
+			fresh = NULL;
+			bucket->uid = uid;
+			bucket->tokens = full;
+			bucket->last = now;
+			hash_add(uidBuckets, &bucket->node, __kuid_val(uid));
+			list_add_tail(&bucket->idle, &idleBuckets);
+		}
+	}
+
+	if (now - bucket->last >= div_u64(full, rate))	// Top up, without overflowing
+	{
+		bucket->tokens = full;
+	}
+	else
+	{
+		bucket->tokens = min(full, bucket->tokens + (now - bucket->last) * rate);
+	}
+
+	bucket->last = now;
+	list_move_tail(&bucket->idle, &idleBuckets);	// Now the most recently used
+
+	if (bucket->tokens >= NSEC_PER_SEC)
+	{
+		bucket->tokens -= NSEC_PER_SEC;
+		ret = 0;
+	}
+
+	spin_unlock(&bucketLock);
+
+out:
+	kfree(fresh);
+
+	list_for_each_entry_safe(bucket, tmp, &expired, idle)
+	{
+		kfree(bucket);
+	}
+
+	return ret;
+}
+
+/*
+Admits a passenger waiting on start, counting them against the queue limits. Returns 0,
+-EAGAIN if a limit turned them away or -ENOMEM, in which case nothing is counted. Every
+admitted passenger must be let go again with elevator_admit_leave.
+*/
+
+int elevator_admit(int start)
+{
+	int limit = READ_ONCE(queue_limit);
+	int floorMax = READ_ONCE(floor_limit);
+	int ret;
+
+	if ((atomic_inc_return(&admitStats.waiting) > limit) && (limit > 0))
+	{
+		atomic_dec(&admitStats.waiting);
+		atomic_long_inc(&admitStats.queueRejects);
+		return -EAGAIN;
+	}
+
+	if ((atomic_inc_return(&floorWaiting[start - 1]) > floorMax) && (floorMax > 0))
+	{
+		elevator_admit_leave(start);
+		atomic_long_inc(&admitStats.floorRejects);
+		return -EAGAIN;
+	}
+
+	if ((ret = takeToken()) != 0)
+	{
+		elevator_admit_leave(start);
+
+		if (ret == -EAGAIN)	// Only count those the rate limit turned away
+		{
+			atomic_long_inc(&admitStats.rateRejects);
+		}
+
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+Lets go of an admitted passenger once they have been picked up or have cancelled, or if the
+request failed after all.
+*/
+
+void elevator_admit_leave(int start)
+{
+	atomic_dec(&floorWaiting[start - 1]);
+	atomic_dec(&admitStats.waiting);
+}
@@ -0,0 +1,29 @@
+#ifndef __ELEVATOR_ADMIT
+#define __ELEVATOR_ADMIT
+
+#include <linux/types.h>
+#include <linux/atomic.h>
+
+/*
+Admission control. Every passenger issued counts against queue_limit and the floor_limit of
+their start floor until they are picked up or cancel, and every request takes a token from
+the caller's rate_limit bucket. Requests over a limit are turned away with -EAGAIN. A user's
+bucket is freed once it has been idle long enough to fill up again.
+*/
+
+struct AdmitStats
+{
+	atomic_t waiting;		// Passengers issued and not yet picked up or cancelled
+	atomic_long_t queueRejects;	// Requests turned away by queue_limit
+	atomic_long_t floorRejects;	// by floor_limit
+	atomic_long_t rateRejects;	// and by rate_limit
+};
+
+extern struct AdmitStats admitStats;
+
+int elevator_admit_init(void);
+void elevator_admit_exit(void);
+int elevator_admit(int start);
+void elevator_admit_leave(int start);
+
+#endif
@@ -0,0 +1,361 @@
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/list.h>
+#include <linux/llist.h>
+#include <linux/bitmap.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_car.h"
+
+/**************************************************************************************************/
+
+/*
+Allocates the per floor arrays of a car, its floor queues and its status snapshot once the
+number of floors is known, with every queue empty. Returns -ENOMEM if any of them could not
+be allocated; freeFloors cleans up whatever was.
+*/
+
+int allocFloors(Car * car)
+{
+	int i;
+
+	car->elevator.passServiced = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->elevator.list = kcalloc(numFloors, sizeof(struct list_head), GFP_KERNEL);
+	car->elevator.carCalls = bitmap_zalloc(numFloors, GFP_KERNEL);
+
+	car->queue.up = kcalloc(numFloors, sizeof(struct list_head), GFP_KERNEL);
+	car->queue.down = kcalloc(numFloors, sizeof(struct list_head), GFP_KERNEL);
+	car->queue.floorSize = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.upSize = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.downSize = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.floorPass = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.floorWeight = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.upPass = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.upWeight = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.downPass = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.downWeight = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.hallCalls = bitmap_zalloc(numFloors, GFP_KERNEL);
+	car->queue.upType = kcalloc(numFloors * BELLHOP, sizeof(struct list_head), GFP_KERNEL);
+	car->queue.downType = kcalloc(numFloors * BELLHOP, sizeof(struct list_head), GFP_KERNEL);
+	car->queue.priorityWaiting = kcalloc(numFloors, sizeof(int), GFP_KERNEL);
+	car->queue.priorityCalls = bitmap_zalloc(numFloors, GFP_KERNEL);
+
+	car->status = kzalloc(STATUS_SIZE(numFloors), GFP_KERNEL);
+
+	if ((car->elevator.passServiced == NULL) || (car->elevator.list == NULL) || (car->elevator.carCalls == NULL) ||
+	    (car->queue.up == NULL) || (car->queue.down == NULL) || (car->queue.floorSize == NULL) ||
+	    (car->queue.upSize == NULL) || (car->queue.downSize == NULL) || (car->queue.floorPass == NULL) ||
+	    (car->queue.floorWeight == NULL) || (car->queue.upPass == NULL) || (car->queue.upWeight == NULL) ||
+	    (car->queue.downPass == NULL) || (car->queue.downWeight == NULL) || (car->queue.hallCalls == NULL) ||
+	    (car->queue.upType == NULL) || (car->queue.downType == NULL) || (car->queue.priorityWaiting == NULL) ||
+	    (car->queue.priorityCalls == NULL) || (car->status == NULL))
+	{
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < numFloors; i++)
+	{
+		INIT_LIST_HEAD(&car->elevator.list[i]);
+		INIT_LIST_HEAD(&car->queue.up[i]);
+		INIT_LIST_HEAD(&car->queue.down[i]);
+	}
+
+	for (i = 0; i < numFloors * BELLHOP; i++)
+	{
+		INIT_LIST_HEAD(&car->queue.upType[i]);
+		INIT_LIST_HEAD(&car->queue.downType[i]);
+	}
+
+	car->status->floors = numFloors;
+	car->status->maxPass = maxPass;
+	car->status->maxWeight = maxWeight;
+
+	return 0;
+}
+
+void freeFloors(Car * car)
+{
+	kfree(car->elevator.passServiced);
+	kfree(car->elevator.list);
+	bitmap_free(car->elevator.carCalls);
+
+	kfree(car->queue.up);
+	kfree(car->queue.down);
+	kfree(car->queue.floorSize);
+	kfree(car->queue.upSize);
+	kfree(car->queue.downSize);
+	kfree(car->queue.floorPass);
+	kfree(car->queue.floorWeight);
+	kfree(car->queue.upPass);
+	kfree(car->queue.upWeight);
+	kfree(car->queue.downPass);
+	kfree(car->queue.downWeight);
+	bitmap_free(car->queue.hallCalls);
+	kfree(car->queue.upType);
+	kfree(car->queue.downType);
+	kfree(car->queue.priorityWaiting);
+	bitmap_free(car->queue.priorityCalls);
+
+	kfree(car->status);
+}
+
+/**************************************************************************************************/
+
+/*
+Returns the floor queue a new passenger waits on, going by their direction.
+*/
+
+struct list_head * arrivalQueue(Car * car, Passenger * p)
+{
+	if (p->dest > p->start)
+	{
+		return &car->queue.up[p->start - 1];
+	}
+	else
+	{
+		return &car->queue.down[p->start - 1];
+	}
+}
+
+/*
+Updates the queue counters and hall calls for a passenger that has just been added to its
+floor queue, and lets the scheduler know. Called by the car's thread with its queueMutex held.
+*/
+
+void countArrival(Car * car, Passenger * p)
+{
+	queueCount(car, p, 1);					// Update queue variables
+	__set_bit(p->start - 1, car->queue.hallCalls);		// Mark the hall call
+
+	if (car->ops->on_request_arrival != NULL)		// Let the scheduler know
+	{
+		car->ops->on_request_arrival(car, p);
+	}
+}
+
+/*
+Moves every passenger pushed onto the car's arrivals list by the system calls onto their
+floor queue, oldest first, and frees any cancelled before they got there. Called by the
+car's thread with its queueMutex held.
+*/
+
+void drainArrivals(Car * car)
+{
+	struct llist_node * node = llist_del_all(&car->arrivals);
+	Passenger * p;
+
+	node = llist_reverse_order(node);	// llist hands them back newest first
+
+	while (node != NULL)
+	{
+		p = llist_entry(node, Passenger, node);
+		node = node->next;
+
+		if (p->cancelled)	// cancel_request already let them go
+		{
+			freePassenger(p);
+			continue;
+		}
+
+		list_add_tail(&p->list, arrivalQueue(car, p));
+		countArrival(car, p);
+	}
+}
+
+/**************************************************************************************************/
+
+/*
+Stops the car at its current floor: lets off everyone getting off here and, unless it is
+draining after a stop call, boards whoever the policy picks. Fills in how many got on and
+off, and puts the car in LOADING if anybody did. arrived says the car has just got here, so
+a stop where nobody gets on or off is counted as useless. Called with both of the car's
+mutexes held.
+*/
+
+void serveFloor(Car * car, int arrived, int draining, int * loadPass, int * unloadPass)
+{
+	*loadPass = 0;
+
+	if (!draining)
+	{
+		drainArrivals(car);	// Pick up new requests
+	}
+
+	*unloadPass = Unload(car);	// Unload applicable passengers
+
+	if ((!draining) && car->ops->should_stop_here(car))	// Load applicable passengers
+	{
+		*loadPass = car->ops->select_passengers_to_load(car);
+	}
+
+	car->elevator.passServiced[car->elevator.currFloor - 1] += *unloadPass;	// Update number of passengers serviced
+
+	if (arrived && (*loadPass + *unloadPass == 0))	// Stopped here for nothing
+	{
+		car->elevator.stats.uselessStops++;
+	}
+
+	if (*loadPass + *unloadPass > 0)	// If anybody loaded or unloaded then change state to LOADING
+	{
+		car->elevator.prevState = car->elevator.state;
+		car->elevator.state = LOADING;
+	}
+}
+
+/*
+Has the policy pick where the car goes next. A car with nobody waiting or aboard goes IDLE;
+while draining only the passengers aboard count. Returns false if the car has nothing left
+to do. Called with the car's elevatorMutex held, and its queueMutex too unless draining.
+*/
+
+int chooseNextFloor(Car * car, int draining)
+{
+	if (draining)
+	{
+		if (car->elevator.passUnit == 0)	// Everyone is off
+		{
+			return 0;
+		}
+
+		car->ops->pick_next_floor(car, 1);
+
+		return 1;
+	}
+
+	drainArrivals(car);	// Pick up requests that came in while loading
+
+	if ((car->queue.size != 0) || (car->elevator.passUnit != 0))
+	{
+		car->ops->pick_next_floor(car, 0);	// Update destination floor
+	}
+	else
+	{
+		car->elevator.state = IDLE;
+	}
+
+	return car->elevator.state != IDLE;
+}
+
+/*
+Moves a car to its destination floor once it has travelled there, adding the trip to its
+travel and load totals. Returns false if it was already there. Called with the car's
+elevatorMutex held.
+*/
+
+int arriveFloor(Car * car)
+{
+	CarStats * stats = &car->elevator.stats;
+	int floors = abs(car->elevator.destFloor - car->elevator.currFloor);
+
+	if (floors == 0)
+	{
+		return 0;
+	}
+
+	if (car->elevator.passUnit > 0)
+	{
+		stats->floorsLoaded += floors;
+	}
+	else
+	{
+		stats->floorsEmpty += floors;
+	}
+
+	stats->passFloors += (u64) car->elevator.passUnit * floors;
+	stats->weightFloors += (u64) car->elevator.weightUnit * floors;
+	stats->stops++;
+
+	car->elevator.currFloor = car->elevator.destFloor;
+
+	return 1;
+}
+
+/*
+Runs a car until hooks->stopping says to stop: it serves the floor it is on, dwells there if
+anybody got on or off, picks where to go next and travels there, or sleeps while it has
+nothing to do. After a stop it carries on with draining set until everyone aboard is off,
+taking nobody new, unless hooks->stopping says to stop outright. served and chose are called
+with the car's mutexes held (only its elevatorMutex in chose while draining) and arrived with
+its elevatorMutex held; the waits are made with neither held.
+*/
+
+void runCar(Car * car, const struct CarHooks * hooks)
+{
+	int loadPass = 0;
+	int unloadPass = 0;
+	int draining = 0;
+	int idle = 0;
+	int arrived = 0;	// Just got to a floor, so the next stop there counts
+	int cF, dF;
+
+	while (1)
+	{
+		if ((!draining) && hooks->stopping(car, 0))	// Stop call, so drop off everyone aboard first
+		{
+			draining = 1;
+		}
+
+		if (draining && ((car->elevator.passUnit == 0) || hooks->stopping(car, 1)))
+		{
+			break;
+		}
+
+		mutex_lock(&car->elevatorMutex);	// Lock mutexes
+		mutex_lock(&car->queueMutex);
+
+		serveFloor(car, arrived, draining, &loadPass, &unloadPass);	// Unload and load applicable passengers
+		arrived = 0;
+
+		hooks->served(car, draining, loadPass, unloadPass);
+
+		mutex_unlock(&car->elevatorMutex);	// Unlock mutexes
+		mutex_unlock(&car->queueMutex);
+
+		if (loadPass + unloadPass > 0)	// Dwell if anybody got off or on
+		{
+			hooks->wait(car, LOAD_SECONDS, draining);
+		}
+
+		mutex_lock(&car->elevatorMutex);
+
+		if (!draining)
+		{
+			mutex_lock(&car->queueMutex);
+		}
+
+		idle = !chooseNextFloor(car, draining);	// Update destination floor
+
+		cF = car->elevator.currFloor;
+		dF = car->elevator.destFloor;
+
+		hooks->chose(car, draining, cF);
+
+		if (!draining)
+		{
+			mutex_unlock(&car->queueMutex);
+		}
+
+		mutex_unlock(&car->elevatorMutex);
+
+		if (idle && (!draining))	// Nothing to do, so sleep until a request or stop call comes in
+		{
+			hooks->idle(car);
+		}
+		else if ((!idle) && (cF != dF))	// Travel to the next floor
+		{
+			hooks->wait(car, FLOOR_SECONDS * abs(dF - cF), draining);
+		}
+
+		mutex_lock(&car->elevatorMutex);
+
+		arrived = arriveFloor(car);	// Update current floor before starting loop again
+
+		if (arrived)
+		{
+			hooks->arrived(car);
+		}
+
+		mutex_unlock(&car->elevatorMutex);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef __ELEVATOR_CAR
+#define __ELEVATOR_CAR
+
+#include "elevator.h"
+
+/*
+One car's floors and its loop, shared by the module and the userspace build in Userspace/.
+runCar is the whole of a car's life from start to stop: the module's car thread runs it with
+hooks that sleep on the car's wait queue and publish, trace and report what it did, and the
+userspace simulator runs it with hooks that move a virtual clock on instead.
+*/
+
+#define LOAD_SECONDS 1		// Time spent at a floor where anybody gets on or off
+#define FLOOR_SECONDS 2		// and travelling each floor
+
+struct CarHooks
+{
+	int (*stopping)(Car * car, int draining);		// True once the car is to stop, see runCar
+	int (*wait)(Car * car, int seconds, int draining);	// Dwell or travel; true if cut short by a stop
+	void (*idle)(Car * car);				// Sleep until a request or stop comes in
+	void (*served)(Car * car, int draining, int loadPass, int unloadPass);	// After each stop
+	void (*chose)(Car * car, int draining, int from);	// After picking the next floor
+	void (*arrived)(Car * car);				// After getting to a new floor
+};
+
+int allocFloors(Car * car);
+void freeFloors(Car * car);
+struct list_head * arrivalQueue(Car * car, Passenger * p);
+void countArrival(Car * car, Passenger * p);
+void drainArrivals(Car * car);
+void serveFloor(Car * car, int arrived, int draining, int * loadPass, int * unloadPass);
+int chooseNextFloor(Car * car, int draining);
+int arriveFloor(Car * car);
+void runCar(Car * car, const struct CarHooks * hooks);
+
+#endif
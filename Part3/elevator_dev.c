@@ -0,0 +1,340 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/miscdevice.h>
+#include <linux/compiler.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_dev.h"
+
+// Status page shared with userspace through mmap of /dev/elevator, and the size of each
+// car's block in it. Car blocks start on their own cache line so cars do not share one
+#define SHM_CAR_OFFSET 64
+
+static void * shm;
+static size_t shmSize;
+static size_t shmCarSize;
+
+static struct miscdevice elevatorDevice;
+
+// The most recent events, for readers of /dev/elevator. eventGeneration counts every event
+// ever recorded, and event n is kept at events[n % EVENT_RING] until it is overwritten
+#define EVENT_RING 1024
+#define EVENT_READ_MAX 64	// Most events one read copies out
+
+static struct elevator_event events[EVENT_RING];
+static u64 eventGeneration;
+static DEFINE_SPINLOCK(eventLock);
+static DECLARE_WAIT_QUEUE_HEAD(eventWait);
+
+// What each open file of /dev/elevator has read up to
+struct EventReader
+{
+	u64 next;	// Generation of the next event to hand out
+};
+
+/**************************************************************************************************/
+
+static struct elevator_shm_car * shmCar(int id)
+{
+	return (struct elevator_shm_car *) ((char *) shm + SHM_CAR_OFFSET + id * shmCarSize);
+}
+
+/*
+Copies a car's status snapshot into its block of the shared page, bumping the block's
+sequence counter to odd before and back to even after. Called from publishElevator and
+publishFloors with the car's statusLock held for writing, which keeps writers to a block
+apart.
+*/
+
+void elevator_dev_publish(Car * car)
+{
+	struct elevator_shm_car * block;
+	u32 seq;
+	int i;
+
+	if (shm == NULL)	// Not set up yet, elevator_dev_init publishes every car when it is
+	{
+		return;
+	}
+
+	block = shmCar(car->id);
+	seq = block->seq;
+
+	WRITE_ONCE(block->seq, seq + 1);
+	smp_wmb();
+
+	block->state = car->status->state;
+	block->heading = car->status->heading;
+	block->currFloor = car->status->currFloor;
+	block->destFloor = car->status->destFloor;
+	block->passUnit = car->status->passUnit;
+	block->weightUnit = car->status->weightUnit;
+
+	for (i = 0; i < numFloors; i++)
+	{
+		block->floor[i].passUnit = car->status->floor[i].passUnit;
+		block->floor[i].weightUnit = car->status->floor[i].weightUnit;
+		block->floor[i].serviced = car->status->floor[i].serviced;
+	}
+
+	smp_wmb();
+	WRITE_ONCE(block->seq, seq + 2);
+}
+
+/*
+Records an event for a car and wakes anyone reading /dev/elevator. Called by the car's
+thread with its elevatorMutex held.
+*/
+
+void elevator_dev_event(Car * car, int type, int count)
+{
+	struct elevator_event * event;
+
+	if (shm == NULL)	// Nobody can be reading yet
+	{
+		return;
+	}
+
+	spin_lock(&eventLock);
+
+	eventGeneration += 1;
+	event = &events[eventGeneration % EVENT_RING];
+
+	event->generation = eventGeneration;
+	event->time = ktime_get_ns();
+	event->type = type;
+	event->car = car->id;
+	event->state = car->elevator.state;
+	event->floor = car->elevator.currFloor;
+	event->passUnit = car->elevator.passUnit;
+	event->weightUnit = car->elevator.weightUnit;
+	event->count = count;
+
+	spin_unlock(&eventLock);
+
+	if (wq_has_sleeper(&eventWait))
+	{
+		wake_up_interruptible(&eventWait);
+	}
+}
+
+static int eventsPending(struct EventReader * reader)
+{
+	return READ_ONCE(eventGeneration) >= reader->next;
+}
+
+static int elevator_dev_open(struct inode * inode, struct file * file)
+{
+	struct EventReader * reader = kmalloc(sizeof(*reader), GFP_KERNEL);
+
+	if (reader == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	spin_lock(&eventLock);
+	reader->next = eventGeneration + 1;	// Only events from now on
+	spin_unlock(&eventLock);
+
+	file->private_data = reader;
+
+	return 0;
+}
+
+static int elevator_dev_release(struct inode * inode, struct file * file)
+{
+	kfree(file->private_data);
+
+	return 0;
+}
+
+/*
+Copies out as many of the events the reader has not seen yet as fit in the buffer, waiting
+for one if there are none. If the reader has fallen more than EVENT_RING events behind it
+skips to the oldest one still kept, which shows up as a jump in generation.
+*/
+
+static ssize_t elevator_dev_read(struct file * file, char __user * buf, size_t size, loff_t * offset)
+{
+	struct EventReader * reader = file->private_data;
+	struct elevator_event * copy;
+	int count = min_t(size_t, size / sizeof(*copy), EVENT_READ_MAX);
+	int i;
+	int ret;
+
+	if (count == 0)
+	{
+		return -EINVAL;
+	}
+
+	while (!eventsPending(reader))
+	{
+		if (file->f_flags & O_NONBLOCK)
+		{
+			return -EAGAIN;
+		}
+
+		ret = wait_event_interruptible(eventWait, eventsPending(reader));
+
+		if (ret != 0)
+		{
+			return ret;
+		}
+	}
+
+	copy = kmalloc_array(count, sizeof(*copy), GFP_KERNEL);
+
+	if (copy == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	spin_lock(&eventLock);
+
+	if (eventGeneration - reader->next >= EVENT_RING)	// Overwritten, skip to the oldest kept
+	{
+		reader->next = eventGeneration - EVENT_RING + 1;
+	}
+
+	for (i = 0; (i < count) && (reader->next <= eventGeneration); i++)
+	{
+		copy[i] = events[reader->next % EVENT_RING];
+		reader->next += 1;
+	}
+
+	spin_unlock(&eventLock);
+
+	ret = i * sizeof(*copy);
+
+	if (copy_to_user(buf, copy, ret))
+	{
+		ret = -EFAULT;
+	}
+
+	kfree(copy);
+
+	return ret;
+}
+
+static __poll_t elevator_dev_poll(struct file * file, poll_table * wait)
+{
+	struct EventReader * reader = file->private_data;
+
+	poll_wait(file, &eventWait, wait);
+
+	return eventsPending(reader) ? (EPOLLIN | EPOLLRDNORM) : 0;
+}
+
+/*
+Maps the status page read-only. The whole page has to be mapped from the start.
+*/
+
+static int elevator_dev_mmap(struct file * file, struct vm_area_struct * vma)
+{
+	if (vma->vm_flags & VM_WRITE)
+	{
+		return -EPERM;
+	}
+
+	if ((vma->vm_pgoff != 0) || (vma->vm_end - vma->vm_start > shmSize))
+	{
+		return -EINVAL;
+	}
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+
+	return remap_vmalloc_range(vma, shm, 0);
+}
+
+static const struct file_operations elevatorDeviceFops =
+{
+	.owner = THIS_MODULE,
+	.open = elevator_dev_open,
+	.release = elevator_dev_release,
+	.read = elevator_dev_read,
+	.poll = elevator_dev_poll,
+	.mmap = elevator_dev_mmap,
+	.llseek = no_llseek,
+};
+
+/*
+Allocates the status page for every car, publishes each car's current status into it and
+registers /dev/elevator. Called once the cars are set up, before their threads can run.
+Returns a negative error if that fails.
+*/
+
+int elevator_dev_init(void)
+{
+	struct elevator_shm_header * header;
+	Car * car;
+	int ret;
+	int i;
+
+	shmCarSize = ALIGN(sizeof(struct elevator_shm_car) + numFloors * sizeof(struct elevator_shm_floor), SMP_CACHE_BYTES);
+	shmSize = PAGE_ALIGN(SHM_CAR_OFFSET + numCars * shmCarSize);
+
+	header = vmalloc_user(shmSize);	// Zeroed, and allowed to be mapped into userspace
+
+	if (header == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	header->magic = ELEVATOR_SHM_MAGIC;
+	header->version = ELEVATOR_SHM_VERSION;
+	header->size = shmSize;
+	header->cars = numCars;
+	header->floors = numFloors;
+	header->carOffset = SHM_CAR_OFFSET;
+	header->carSize = shmCarSize;
+
+	shm = header;
+
+	for (i = 0; i < numCars; i++)
+	{
+		car = &cars[i];
+
+		write_seqlock(&car->statusLock);
+		elevator_dev_publish(car);
+		write_sequnlock(&car->statusLock);
+	}
+
+	elevatorDevice.minor = MISC_DYNAMIC_MINOR;
+	elevatorDevice.name = "elevator";
+	elevatorDevice.fops = &elevatorDeviceFops;
+	elevatorDevice.mode = 0444;
+
+	ret = misc_register(&elevatorDevice);
+
+	if (ret != 0)
+	{
+		shm = NULL;
+		vfree(header);
+	}
+
+	return ret;
+}
+
+/*
+Removes /dev/elevator and frees the status page. Called once the car threads are stopped.
+Pages still mapped by a process stay around until it unmaps them.
+*/
+
+void elevator_dev_exit(void)
+{
+	misc_deregister(&elevatorDevice);
+
+	vfree(shm);
+	shm = NULL;
+}
@@ -0,0 +1,97 @@
+#ifndef __ELEVATOR_DEV
+#define __ELEVATOR_DEV
+
+#include <linux/types.h>
+
+/*
+Layout of the read-only status page /dev/elevator maps into userspace. It starts with an
+elevator_shm_header, followed by one elevator_shm_car block for each car, carSize bytes
+apart from carOffset on. Each car block ends in one elevator_shm_floor for each floor.
+This header can be included from userspace as well as the module.
+
+A car's seq is odd while the module is updating the block. A reader copies a block like so:
+
+	do {
+		seq = __atomic_load_n(&car->seq, __ATOMIC_ACQUIRE);
+		copy the fields
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || (seq != __atomic_load_n(&car->seq, __ATOMIC_RELAXED)));
+
+Fields are only ever added at the end of a struct, with version bumped, so a reader should
+check magic and version and use carOffset and carSize rather than sizeof.
+*/
+
+#define ELEVATOR_SHM_MAGIC 0x454c4556	// "ELEV"
+#define ELEVATOR_SHM_VERSION 1
+
+struct elevator_shm_header
+{
+	__u32 magic;
+	__u32 version;
+	__u32 size;		// Bytes in the mapping
+	__u32 cars;
+	__u32 floors;
+	__u32 carOffset;	// Offset of the first car's block
+	__u32 carSize;		// Bytes from one car's block to the next
+	__u32 reserved;
+};
+
+struct elevator_shm_floor
+{
+	__u32 passUnit;		// Load waiting for this car on the floor
+	__u32 weightUnit;
+	__u32 serviced;		// Passengers this car dropped off at the floor
+};
+
+struct elevator_shm_car
+{
+	__u32 seq;		// Odd while the block is being updated
+	__u32 state;		// OFFLINE 0, IDLE 1, LOADING 2, UP 3, DOWN 4
+	__u32 heading;		// UP or DOWN while moving or loading, IDLE otherwise
+	__u32 currFloor;
+	__u32 destFloor;
+	__u32 passUnit;
+	__u32 weightUnit;	// In tenths, as /proc/elevator shows them
+	__u32 reserved;
+	struct elevator_shm_floor floor[];
+};
+
+/*
+Reading /dev/elevator returns elevator_event records, as many whole records as fit in the
+buffer, blocking until there is at least one unless the file was opened O_NONBLOCK. poll
+and epoll report it readable when there are. A reader starts with the events after it
+opened the device. Every event gets the next generation number, so a jump in generation
+means the reader fell too far behind and the events in between were dropped.
+*/
+
+#define ELEVATOR_EVENT_STATE 1		// The car changed state
+#define ELEVATOR_EVENT_FLOOR 2		// The car arrived at a floor
+#define ELEVATOR_EVENT_LOAD 3		// count passengers boarded
+#define ELEVATOR_EVENT_UNLOAD 4		// count passengers got off
+
+struct elevator_event
+{
+	__u64 generation;
+	__u64 time;		// CLOCK_MONOTONIC nanoseconds
+	__u32 type;
+	__u32 car;
+	__u32 state;
+	__u32 floor;
+	__u32 passUnit;		// Car's load after the event
+	__u32 weightUnit;
+	__u32 count;
+	__u32 reserved;
+};
+
+#ifdef __KERNEL__
+
+#include "elevator.h"
+
+int elevator_dev_init(void);
+void elevator_dev_exit(void);
+void elevator_dev_publish(Car * car);
+void elevator_dev_event(Car * car, int type, int count);
+
+#endif
+
+#endif
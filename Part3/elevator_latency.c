@@ -0,0 +1,175 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/spinlock.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/ktime.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_latency.h"
+
+// Latencies of every passenger dropped off since the module was loaded or the stats were
+// last reset. Updated by the car threads under latencyLock
+struct LatencyStats latencyStats;
+EXPORT_SYMBOL(latencyStats);
+DEFINE_SPINLOCK(latencyLock);
+EXPORT_SYMBOL(latencyLock);
+
+/**************************************************************************************************/
+
+/*
+Returns the histogram bucket a latency goes in. Below 4 microseconds each value has its own
+bucket, and from there each power of two is split into four.
+*/
+
+static int latencyBucket(u64 us)
+{
+	int k;
+	int bucket;
+
+	if (us < 4)
+	{
+		return us;
+	}
+
+	k = ilog2(us);
+	bucket = 4 * (k - 1) + ((us >> (k - 2)) & 3);
+
+	return min(bucket, LATENCY_BUCKETS - 1);
+}
+
+/*
+Returns the largest latency that goes in a bucket.
+*/
+
+static u64 latencyBucketTop(int bucket)
+{
+	int k;
+
+	if (bucket < 4)
+	{
+		return bucket;
+	}
+
+	k = bucket / 4 + 1;
+
+	return ((u64) (4 + bucket % 4) << (k - 2)) + ((u64) 1 << (k - 2)) - 1;
+}
+
+static void latencyAdd(struct LatencyHist * hist, u64 us)
+{
+	hist->bucket[latencyBucket(us)] += 1;
+	hist->count += 1;
+
+	if (us > hist->max)
+	{
+		hist->max = us;
+	}
+}
+
+static void latencyAddSet(struct LatencySet * set, u64 wait, u64 ride)
+{
+	latencyAdd(&set->wait, wait);
+	latencyAdd(&set->ride, ride);
+	latencyAdd(&set->trip, wait + ride);
+}
+
+/*
+Returns the latency, in microseconds, that percent of the histogram is at or under. It is
+the top of the bucket that percentile falls in, but never more than the longest latency
+recorded. Returns 0 for an empty histogram.
+*/
+
+u64 elevator_latency_percentile(const struct LatencyHist * hist, int percent)
+{
+	u64 rank = div_u64((u64) hist->count * percent + 99, 100);	// Rounded up
+	u64 seen = 0;
+	int i;
+
+	if (hist->count == 0)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		seen += hist->bucket[i];
+
+		if (seen >= rank)
+		{
+			return min(latencyBucketTop(i), hist->max);
+		}
+	}
+
+	return hist->max;
+}
+EXPORT_SYMBOL(elevator_latency_percentile);
+
+/*
+Records the wait, ride and trip times of a passenger being dropped off at time now, in the
+overall, passenger type and start floor histograms.
+*/
+
+void elevator_latency_record(Passenger * passenger, u64 now)
+{
+	u64 wait = div_u64(passenger->boardTime - passenger->issueTime, NSEC_PER_USEC);
+	u64 ride = div_u64(now - passenger->boardTime, NSEC_PER_USEC);
+	int target = READ_ONCE(waitTarget[passenger->type - 1]);
+
+	spin_lock(&latencyLock);
+
+	latencyAddSet(&latencyStats.all, wait, ride);
+	latencyAddSet(&latencyStats.type[passenger->type - 1], wait, ride);
+	latencyAddSet(&latencyStats.floor[passenger->start - 1], wait, ride);
+
+	if ((target > 0) && (wait > (u64) target * USEC_PER_MSEC))	// Missed the type's target
+	{
+		latencyStats.late[passenger->type - 1] += 1;
+	}
+
+	spin_unlock(&latencyLock);
+}
+
+/*
+Clears every histogram, for /proc/elevator_latency.
+*/
+
+void elevator_latency_reset(void)
+{
+	spin_lock(&latencyLock);
+
+	memset(&latencyStats.all, 0, sizeof(latencyStats.all));
+	memset(latencyStats.type, 0, sizeof(latencyStats.type));
+	memset(latencyStats.late, 0, sizeof(latencyStats.late));
+	memset(latencyStats.floor, 0, numFloors * sizeof(*latencyStats.floor));
+
+	spin_unlock(&latencyLock);
+}
+EXPORT_SYMBOL(elevator_latency_reset);
+
+/*
+Allocates the per floor histograms once the number of floors is known. Returns -ENOMEM if
+that fails.
+*/
+
+int elevator_latency_init(void)
+{
+	latencyStats.floor = kvcalloc(numFloors, sizeof(*latencyStats.floor), GFP_KERNEL);
+
+	if (latencyStats.floor == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void elevator_latency_exit(void)
+{
+	kvfree(latencyStats.floor);
+	latencyStats.floor = NULL;
+}
@@ -0,0 +1,52 @@
+#ifndef __ELEVATOR_LATENCY
+#define __ELEVATOR_LATENCY
+
+#include <linux/types.h>
+#include <linux/spinlock.h>
+
+#include "elevator.h"
+
+/*
+Log scale histogram of latencies in microseconds. Every power of two is split into four
+buckets, so a latency is known to within a quarter of its size.
+*/
+
+#define LATENCY_BUCKETS 144	// Up to 2^37 microseconds, a day and a half
+
+struct LatencyHist
+{
+	u32 bucket[LATENCY_BUCKETS];
+	u32 count;
+	u64 max;		// Longest latency recorded
+};
+
+/*
+Wait (issue to boarding), ride (boarding to drop off) and trip (issue to drop off) times of
+a group of passengers.
+*/
+
+struct LatencySet
+{
+	struct LatencyHist wait;
+	struct LatencyHist ride;
+	struct LatencyHist trip;
+};
+
+struct LatencyStats
+{
+	struct LatencySet all;
+	struct LatencySet type[BELLHOP];	// By passenger type
+	struct LatencySet * floor;		// By start floor, numFloors long
+	u32 late[BELLHOP];			// By type, waits longer than their wait_target
+};
+
+extern struct LatencyStats latencyStats;
+extern spinlock_t latencyLock;
+
+int elevator_latency_init(void);
+void elevator_latency_exit(void);
+void elevator_latency_record(Passenger * passenger, u64 now);
+void elevator_latency_reset(void);
+u64 elevator_latency_percentile(const struct LatencyHist * hist, int percent);
+
+#endif
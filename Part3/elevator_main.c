@@ -0,0 +1,1627 @@
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/linkage.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/list.h>
+#include <linux/sched.h>
+#include <linux/mutex.h>
+#include <linux/time.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/wait.h>
+#include <linux/bitmap.h>
+#include <linux/moduleparam.h>
+#include <linux/spinlock.h>
+#include <linux/llist.h>
+#include <linux/seqlock.h>
+#include <linux/atomic.h>
+#include <linux/cpumask.h>
+#include <linux/numa.h>
+#include <linux/ktime.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_car.h"
+#include "elevator_latency.h"
+#include "elevator_dev.h"
+#include "elevator_sysfs.h"
+#include "elevator_ticket.h"
+#include "elevator_admit.h"
+
+#define CREATE_TRACE_POINTS
+#include "elevator_trace.h"
+
+MODULE_LICENSE("GPL");
+
+// Scheduling policy, chosen at module load with sched= and changed through /proc/elevator_sched
+static char * sched = "scan";
+module_param(sched, charp, 0444);
+MODULE_PARM_DESC(sched, "Scheduling policy: scan, look, clook, nearest or dest");
+
+struct elevator_sched_ops * schedOps;
+EXPORT_SYMBOL(schedOps);
+
+// How waiting passengers are picked to board. fifo boards them in order up to the first one
+// who does not fit; fill boards the mix that carries the most, but never passes anyone over
+// more than board_skip_max times
+static char * boarding = "fifo";
+module_param(boarding, charp, 0444);
+MODULE_PARM_DESC(boarding, "Boarding order: fifo or fill");
+
+int fillBoarding;
+
+int boardSkipMax = 3;
+module_param_named(board_skip_max, boardSkipMax, int, 0644);
+MODULE_PARM_DESC(board_skip_max, "Times fill boarding may pass a passenger over");
+
+// Building geometry and car limits. Weights are in the tenths /proc/elevator reports them in
+int numFloors = MAX_FLOOR;
+module_param_named(floors, numFloors, int, 0444);
+MODULE_PARM_DESC(floors, "Number of floors in the building");
+EXPORT_SYMBOL(numFloors);
+
+int maxPass = MAX_PASS;
+module_param_named(max_pass, maxPass, int, 0444);
+MODULE_PARM_DESC(max_pass, "Passenger units the elevator holds");
+
+int maxWeight = MAX_WEIGHT;
+module_param_named(max_weight, maxWeight, int, 0444);
+MODULE_PARM_DESC(max_weight, "Weight units the elevator holds");
+
+// Passenger and weight units of each passenger type, in the order adult, child, room service
+// and bellhop
+static int typePass[BELLHOP] = {1, 1, 2, 2};
+module_param_array_named(pass_units, typePass, int, NULL, 0444);
+MODULE_PARM_DESC(pass_units, "Passenger units of each passenger type");
+
+static int typeWeight[BELLHOP] = {10, 5, 20, 40};
+module_param_array_named(weight_units, typeWeight, int, NULL, 0444);
+MODULE_PARM_DESC(weight_units, "Weight units of each passenger type");
+
+// Priority classes. Waiting passengers of a higher type_priority board first, and nearest
+// call first heads for floors where someone above priority 0 is waiting. A passenger goes up
+// one level for every priority_aging seconds they wait, so nobody waits forever. wait_target
+// is each type's target wait in milliseconds, and /proc/elevator_latency counts the
+// passengers who waited longer. All of them can be changed through
+// /sys/module/elevator/parameters while the elevator runs
+int typePriority[BELLHOP] = {0, 0, 0, 0};
+module_param_array_named(type_priority, typePriority, int, NULL, 0644);
+MODULE_PARM_DESC(type_priority, "Priority of each passenger type, higher boards first");
+EXPORT_SYMBOL(typePriority);
+
+int priorityAging = 30;
+module_param_named(priority_aging, priorityAging, int, 0644);
+MODULE_PARM_DESC(priority_aging, "Seconds of waiting that raise a passenger's priority by one, 0 for never");
+
+int waitTarget[BELLHOP] = {0, 0, 0, 0};
+module_param_array_named(wait_target, waitTarget, int, NULL, 0644);
+MODULE_PARM_DESC(wait_target, "Target wait of each passenger type in milliseconds, 0 for none");
+EXPORT_SYMBOL(waitTarget);
+
+// Cars in the elevator bank, each run by its own thread. With bind_cars set, each car's
+// thread is kept on its own CPU
+int numCars = 1;
+module_param_named(cars, numCars, int, 0444);
+MODULE_PARM_DESC(cars, "Number of cars in the elevator bank");
+EXPORT_SYMBOL(numCars);
+
+static bool bind_cars = false;
+module_param(bind_cars, bool, 0444);
+MODULE_PARM_DESC(bind_cars, "Run each car's thread on its own CPU");
+
+// Declaring Cars
+struct Car * cars;
+EXPORT_SYMBOL(cars);
+
+// Serializes policy switches, which go through the cars one at a time
+static DEFINE_MUTEX(schedMutex);
+
+// Passenger objects come from their own slab cache, and unloaded passengers are kept on a
+// bounded free list for the next request to reuse. passengerStats counts both for sizing
+// memory; the pool has not been timed against plain kmalloc
+static int pool_size = 64;
+module_param(pool_size, int, 0444);
+MODULE_PARM_DESC(pool_size, "Most unloaded passengers kept for reuse");
+
+static struct kmem_cache * passengerCache;
+static struct list_head passengerPool;
+static spinlock_t poolLock;
+
+struct PassengerStats passengerStats;
+EXPORT_SYMBOL(passengerStats);
+
+// New passengers are pushed onto their car's arrivals list by the system calls without taking
+// any lock, and moved onto the floor queues by the car's thread. Each car's status snapshot is
+// rewritten under its statusLock whenever the car or its floor queues change, so /proc/elevator
+// and the dispatcher never have to take the mutexes
+
+/**************************************************************************************************/
+
+/*
+Hands out a Passenger, reusing one from the free list if there is one and falling back to
+the slab cache otherwise. Returns NULL if the allocation fails.
+*/
+
+static Passenger * allocPassenger(void)
+{
+	Passenger * passenger = NULL;
+
+	spin_lock(&poolLock);
+
+	if (!list_empty(&passengerPool))	// Reuse a passenger from the pool
+	{
+		passenger = list_first_entry(&passengerPool, Passenger, list);
+		list_del(&passenger->list);
+		passengerStats.pooled -= 1;
+		passengerStats.poolAllocs += 1;
+	}
+
+	spin_unlock(&poolLock);
+
+	if (passenger == NULL)	// Pool is empty, so go to the slab cache
+	{
+		passenger = kmem_cache_alloc(passengerCache, GFP_KERNEL);
+
+		if (passenger == NULL)
+		{
+			return NULL;
+		}
+
+		spin_lock(&poolLock);
+		passengerStats.slabAllocs += 1;
+		spin_unlock(&poolLock);
+	}
+
+	spin_lock(&poolLock);
+
+	passengerStats.live += 1;	// Update live count and its high-water mark
+	if (passengerStats.live > passengerStats.livePeak)
+	{
+		passengerStats.livePeak = passengerStats.live;
+	}
+
+	spin_unlock(&poolLock);
+
+	return passenger;
+}
+
+/*
+Fills batch with up to count passengers for a batched request: first as many as the free
+list holds, taken under a single lock, then the rest with one bulk allocation from the slab
+cache. Returns how many were allocated.
+*/
+
+static int allocPassengers(Passenger ** batch, int count)
+{
+	int got = 0;
+	int slab = 0;
+
+	spin_lock(&poolLock);
+
+	while ((got < count) && (!list_empty(&passengerPool)))	// Take what we can from the pool
+	{
+		batch[got] = list_first_entry(&passengerPool, Passenger, list);
+		list_del(&batch[got]->list);
+		got++;
+	}
+
+	passengerStats.pooled -= got;
+	passengerStats.poolAllocs += got;
+
+	spin_unlock(&poolLock);
+
+	if (got < count)	// Bulk allocate the rest from the slab cache
+	{
+		slab = kmem_cache_alloc_bulk(passengerCache, GFP_KERNEL, count - got, (void **) &batch[got]);
+		got += slab;
+	}
+
+	spin_lock(&poolLock);
+
+	passengerStats.slabAllocs += slab;
+	passengerStats.live += got;	// Update live count and its high-water mark
+	if (passengerStats.live > passengerStats.livePeak)
+	{
+		passengerStats.livePeak = passengerStats.live;
+	}
+
+	spin_unlock(&poolLock);
+
+	return got;
+}
+
+/*
+Gives back a Passenger that is no longer on any list. It goes on the free list unless that is
+already holding pool_size passengers, in which case it goes back to the slab cache.
+*/
+
+void freePassenger(Passenger * passenger)
+{
+	spin_lock(&poolLock);
+
+	passengerStats.live -= 1;
+
+	if (passengerStats.pooled < pool_size)
+	{
+		list_add(&passenger->list, &passengerPool);
+		passengerStats.pooled += 1;
+
+		if (passengerStats.pooled > passengerStats.pooledPeak)
+		{
+			passengerStats.pooledPeak = passengerStats.pooled;
+		}
+
+		passenger = NULL;
+	}
+
+	spin_unlock(&poolLock);
+
+	if (passenger != NULL)
+	{
+		kmem_cache_free(passengerCache, passenger);
+	}
+}
+
+/*
+Returns true if the module parameters describe a building the elevator can run in: at least
+two floors, at least one car, and room in an empty car for one passenger of every type.
+*/
+
+static int validGeometry(void)
+{
+	int i;
+
+	if ((numFloors < 2) || (numFloors > FLOOR_LIMIT) || (numCars < 1) || (numCars > CAR_LIMIT) ||
+	    (maxPass <= 0) || (maxWeight <= 0))
+	{
+		return 0;
+	}
+
+	for (i = 0; i < BELLHOP; i++)
+	{
+		if ((typePass[i] <= 0) || (typePass[i] > maxPass) || (typeWeight[i] <= 0) || (typeWeight[i] > maxWeight))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+Frees every passenger on a list back to the slab cache. Only used on module exit.
+*/
+
+static void freeList(struct list_head * list)
+{
+	struct list_head * temp = NULL;
+	struct list_head * dummy = NULL;
+
+	list_for_each_safe(temp, dummy, list)
+	{
+		list_del(temp);
+		kmem_cache_free(passengerCache, list_entry(temp, Passenger, list));
+	}
+}
+
+/*
+Returns the way a car is heading: UP or DOWN while it is moving or loading on its way
+somewhere, IDLE otherwise.
+*/
+
+static int heading(Car * car)
+{
+	int state = car->elevator.state;
+
+	if (state == LOADING)
+	{
+		state = car->elevator.prevState;
+	}
+
+	return ((state == UP) || (state == DOWN)) ? state : IDLE;
+}
+
+/*
+Adds the time since a car's last published state change to the state it was in then.
+Called with the car's elevatorMutex held, when the state has changed.
+*/
+
+static void countStateTime(Car * car)
+{
+	u64 now = ktime_get_ns();
+
+	car->elevator.stats.stateTime[car->status->state] += now - car->elevator.stats.stateSince;
+	car->elevator.stats.stateSince = now;
+}
+
+/*
+Copies a car's own state into its status snapshot, tracing the state change and letting
+/dev/elevator readers know if the state or floor is not the one last published. Called with
+the car's elevatorMutex held.
+*/
+
+static void publishElevator(Car * car)
+{
+	int i;
+
+	if (car->status->state != car->elevator.state)
+	{
+		countStateTime(car);
+		trace_elevator_state_change(car, car->status->state);
+		elevator_dev_event(car, ELEVATOR_EVENT_STATE, 0);
+	}
+
+	if (car->status->currFloor != car->elevator.currFloor)
+	{
+		elevator_dev_event(car, ELEVATOR_EVENT_FLOOR, 0);
+	}
+
+	write_seqlock(&car->statusLock);
+
+	car->status->state = car->elevator.state;
+	car->status->heading = heading(car);
+	car->status->currFloor = car->elevator.currFloor;
+	car->status->destFloor = car->elevator.destFloor;
+	car->status->passUnit = car->elevator.passUnit;
+	car->status->weightUnit = car->elevator.weightUnit;
+	car->status->policy = car->ops->name;
+	car->status->stats = car->elevator.stats;
+
+	for (i = 0; i < numFloors; i++)
+	{
+		car->status->floor[i].serviced = car->elevator.passServiced[i];
+	}
+
+	elevator_dev_publish(car);	// And the page mapped from /dev/elevator
+
+	write_sequnlock(&car->statusLock);
+}
+
+/*
+Copies the passenger and weight load waiting on each floor for a car into its status
+snapshot. Called with the car's queueMutex held.
+*/
+
+static void publishFloors(Car * car)
+{
+	int i;
+
+	write_seqlock(&car->statusLock);
+
+	for (i = 0; i < numFloors; i++)
+	{
+		car->status->floor[i].passUnit = car->queue.floorPass[i];
+		car->status->floor[i].weightUnit = car->queue.floorWeight[i];
+	}
+
+	elevator_dev_publish(car);	// And the page mapped from /dev/elevator
+
+	write_sequnlock(&car->statusLock);
+}
+
+#ifdef ELEVATOR_DEBUG
+/*
+Debug builds only: walks every floor queue of a car and checks the running totals in its
+queue against what is actually queued. Called with the car's queueMutex held.
+*/
+
+void checkQueueTotals(Car * car)
+{
+	struct list_head * temp;
+	Passenger * p;
+	int size = 0, pU = 0, wU = 0;
+	int upPU, upWU, downPU, downWU, prio, typed;
+	int i, t;
+
+	for (i = 0; i < numFloors; i++)
+	{
+		upPU = upWU = downPU = downWU = prio = 0;
+
+		list_for_each(temp, &car->queue.up[i])
+		{
+			p = list_entry(temp, Passenger, list);
+			upPU += p->passUnit;
+			upWU += p->weightUnit;
+			prio += (p->priority > 0);
+			size++;
+		}
+
+		list_for_each(temp, &car->queue.down[i])
+		{
+			p = list_entry(temp, Passenger, list);
+			downPU += p->passUnit;
+			downWU += p->weightUnit;
+			prio += (p->priority > 0);
+			size++;
+		}
+
+		WARN_ON(car->queue.upPass[i] != upPU);
+		WARN_ON(car->queue.upWeight[i] != upWU);
+		WARN_ON(car->queue.downPass[i] != downPU);
+		WARN_ON(car->queue.downWeight[i] != downWU);
+		WARN_ON(car->queue.floorPass[i] != upPU + downPU);
+		WARN_ON(car->queue.floorWeight[i] != upWU + downWU);
+		WARN_ON(car->queue.floorSize[i] != car->queue.upSize[i] + car->queue.downSize[i]);
+		WARN_ON(car->queue.priorityWaiting[i] != prio);
+		WARN_ON(test_bit(i, car->queue.priorityCalls) != (prio != 0));
+
+		typed = 0;
+
+		for (t = 0; t < BELLHOP; t++)
+		{
+			list_for_each(temp, &car->queue.upType[i * BELLHOP + t])
+			{
+				typed++;
+			}
+
+			list_for_each(temp, &car->queue.downType[i * BELLHOP + t])
+			{
+				typed++;
+			}
+		}
+
+		WARN_ON(car->queue.floorSize[i] != typed);
+
+		pU += upPU + downPU;
+		wU += upWU + downWU;
+	}
+
+	WARN_ON(car->queue.size != size);
+	WARN_ON(car->queue.passUnit != pU);
+	WARN_ON(car->queue.weightUnit != wU);
+}
+#endif
+
+/*
+Returns true if the car's thread has been asked to stop. While the car is still draining
+passengers after a stop call, only kthread_stop counts as a reason to stop.
+*/
+
+static int stopRequested(Car * car, int draining)
+{
+	if (kthread_should_stop())
+	{
+		return 1;
+	}
+
+	return (!draining) && READ_ONCE(car->elevator.stop_call);
+}
+
+/*
+Fills in the passenger and weight units for a passenger type from the pass_units and
+weight_units tables. Returns 1 if the type is not valid, 0 otherwise.
+*/
+
+static int passengerUnits(int type, int * pU, int * wU)
+{
+	if ((type < ADULTS) || (type > BELLHOP))
+	{
+		return 1;
+	}
+
+	*pU = typePass[type - 1];
+	*wU = typeWeight[type - 1];
+
+	return 0;
+}
+
+/*
+Returns true if the start and destination floors are within specifications.
+*/
+
+static int validFloors(int start, int dest)
+{
+	return (start >= MIN_FLOOR) && (start <= numFloors) && (dest >= MIN_FLOOR) && (dest <= numFloors) && (start != dest);
+}
+
+/*
+Replaces ssleep for the dwell and travel times. Sleeps on the car's wait queue for the
+given number of seconds, but returns straight away if a stop is requested in the meantime.
+New arrivals are moved onto the floor queues while waiting so the queue stays current.
+Returns true if the wait was cut short by a stop.
+*/
+
+static int Elevator_Wait(Car * car, int seconds, int draining)
+{
+	long remaining = seconds * HZ;
+
+	while ((remaining > 0) && (!stopRequested(car, draining)))
+	{
+		remaining = wait_event_interruptible_timeout(car->wait,
+			stopRequested(car, draining) || (!llist_empty(&car->arrivals)), remaining);
+
+		if (!llist_empty(&car->arrivals))
+		{
+			mutex_lock(&car->queueMutex);
+			drainArrivals(car);
+			publishFloors(car);
+			mutex_unlock(&car->queueMutex);
+		}
+	}
+
+	return stopRequested(car, draining);
+}
+
+/*
+Blocks the car's thread while it is IDLE with nobody waiting, instead of spinning around
+the main loop. Woken up by my_issue_request, my_stop_elevator and kthread_stop.
+*/
+
+static void Elevator_Idle(Car * car)
+{
+	wait_event_interruptible(car->wait, (!llist_empty(&car->arrivals)) || stopRequested(car, 0));
+}
+
+/*
+runCar hooks for a car's thread. After each stop and each pick of the next floor the car
+tells /dev/elevator readers who got off and on, traces where it is going, has debug builds
+check the queue totals and updates the status snapshot.
+*/
+
+static void threadServed(Car * car, int draining, int loadPass, int unloadPass)
+{
+	if (unloadPass > 0)	// Tell /dev/elevator readers who got off and on
+	{
+		elevator_dev_event(car, ELEVATOR_EVENT_UNLOAD, unloadPass);
+	}
+
+	if (loadPass > 0)
+	{
+		elevator_dev_event(car, ELEVATOR_EVENT_LOAD, loadPass);
+	}
+
+	if (!draining)
+	{
+		checkQueueTotals(car);	// Debug builds check the running totals
+		publishFloors(car);	// Update the status snapshot
+	}
+
+	publishElevator(car);
+}
+
+static void threadChose(Car * car, int draining, int from)
+{
+	if (from != car->elevator.destFloor)
+	{
+		trace_elevator_floor_departed(car);
+	}
+
+	if (!draining)
+	{
+		checkQueueTotals(car);	// Debug builds check the running totals
+		publishFloors(car);	// Update the status snapshot
+	}
+
+	publishElevator(car);
+}
+
+static void threadArrived(Car * car)
+{
+	trace_elevator_floor_arrived(car);
+	publishElevator(car);
+}
+
+static const struct CarHooks threadHooks =
+{
+	.stopping = stopRequested,
+	.wait = Elevator_Wait,
+	.idle = Elevator_Idle,
+	.served = threadServed,
+	.chose = threadChose,
+	.arrived = threadArrived,
+};
+
+/*
+Process for running one car, passed in data. The scheduling algorithm is whichever policy
+the car's ops point at, SCAN by default. runCar runs the car until it is stopped and everyone
+aboard is off, then the car goes OFFLINE.
+*/
+
+int Elevator_Process(void * data)
+{
+	Car * car = data;
+
+	runCar(car, &threadHooks);
+
+	mutex_lock(&car->elevatorMutex);
+
+	car->elevator.state = OFFLINE;
+	publishElevator(car);
+
+	mutex_unlock(&car->elevatorMutex);
+
+	set_current_state(TASK_INTERRUPTIBLE);	// Park until kthread_stop so the thread can be reaped
+
+	while (!kthread_should_stop())
+	{
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+/**************************************************************************************************/
+
+/*
+Estimates how many seconds a car would take to reach a new hall call at start going the way
+of dest, from its status snapshot: two seconds for every floor it has to travel along its
+sweep to get there, plus a second for every passenger it has yet to drop off. A car that is
+not running, or is draining after a stop call, loses to any car that is.
+*/
+
+static int carEta(Car * car, int start, int dest)
+{
+	int sweep = 2 * (numFloors - 1);	// Floors travelled going all the way up and back down
+	int state, way, floor;
+	int here, there, distance;
+	int eta;
+	unsigned int seq;
+
+	do {	// Copy what we need from the snapshot, trying again if the car changed it meanwhile
+		seq = read_seqbegin(&car->statusLock);
+		state = car->status->state;
+		way = car->status->heading;
+		floor = car->status->currFloor;
+	} while (read_seqretry(&car->statusLock, seq));
+
+	if (way == IDLE)	// Straight there
+	{
+		distance = abs(start - floor);
+	}
+	else			// Places along the sweep, counting up from floor 1 and then back down
+	{
+		here = (way == UP) ? floor - 1 : sweep - (floor - 1);
+		there = (dest > start) ? start - 1 : sweep - (start - 1);
+		distance = (there - here + sweep) % sweep;
+	}
+
+	eta = 2 * distance + atomic_read(&car->assigned);
+
+	if ((state == OFFLINE) || READ_ONCE(car->elevator.stop_call))
+	{
+		eta += INT_MAX / 2;
+	}
+
+	return eta;
+}
+
+/*
+Dispatcher. Gives a new hall call to the car with the lowest estimated time to arrival and
+counts the passenger against that car until they are dropped off.
+*/
+
+static Car * dispatchCar(int start, int dest)
+{
+	Car * best = &cars[0];
+	int bestEta = carEta(best, start, dest);
+	int eta;
+	int i;
+
+	for (i = 1; i < numCars; i++)
+	{
+		eta = carEta(&cars[i], start, dest);
+
+		if (eta < bestEta)
+		{
+			best = &cars[i];
+			bestEta = eta;
+		}
+	}
+
+	atomic_inc(&best->assigned);
+
+	return best;
+}
+
+/*
+Starts a car's thread if the car is OFFLINE, on the CPU set aside for it if bind_cars is set.
+Returns 0 if the car was started, 1 if it was already running and -1 if the thread could not
+be created. Called with the car's elevatorMutex held.
+*/
+
+static int startCar(Car * car)
+{
+	struct task_struct * thread;
+	int i;
+
+	if (car->elevator.state != OFFLINE)
+	{
+		return 1;
+	}
+
+	if (car->thread != NULL)	// Reap the thread from the previous run
+	{
+		kthread_stop(car->thread);
+		car->thread = NULL;
+	}
+
+	car->elevator.state = IDLE;	// Initialize elevator variables
+	car->elevator.currFloor = 1;
+	car->elevator.destFloor = 1;
+	car->elevator.passUnit = 0;
+	car->elevator.weightUnit = 0;
+	car->elevator.stop_call = 0;
+	for (i = 0; i < numFloors; i++)
+	{
+		INIT_LIST_HEAD(&car->elevator.list[i]);
+	}
+	bitmap_zero(car->elevator.carCalls, numFloors);
+
+	publishElevator(car);
+
+	thread = kthread_create(Elevator_Process, car, "elevator/%d", car->id);	// Create a new thread to run the car
+
+	if (IS_ERR(thread) != 0)	// Error checking for creating the thread
+	{
+		printk(KERN_ERR "Elevator Process failed: thread error\n");
+		return -1;
+	}
+
+	if (bind_cars)
+	{
+		kthread_bind(thread, cpumask_local_spread(car->id, NUMA_NO_NODE));
+	}
+
+	car->thread = thread;
+	wake_up_process(thread);
+
+	return 0;
+}
+
+/*
+System call function to start the elevator process. Starts every car that is not already
+running. Returns 0 if any car was started, 1 if they were all running already and -1 if a
+car's thread could not be created.
+*/
+extern int (*STUB_start_elevator)(void);
+int my_start_elevator(void)
+{
+	int temp = 1;
+	int ret;
+	int i;
+
+	for (i = 0; i < numCars; i++)
+	{
+		mutex_lock(&cars[i].elevatorMutex);	// Lock Elevator mutex
+
+		ret = startCar(&cars[i]);
+
+		mutex_unlock(&cars[i].elevatorMutex);	// Unlock mutex
+
+		if (ret < temp)
+		{
+			temp = ret;
+		}
+	}
+
+	return temp;
+}
+
+/*
+Checks a request, admits it and allocates and fills in its passenger. Returns 0, -EINVAL if
+the type or floors are not valid, -EAGAIN if admission control turned it away, or -ENOMEM.
+*/
+
+static int newPassenger(int type, int start, int dest, Passenger ** passenger)
+{
+        int pU = 0;
+	int wU = 0;
+
+	Passenger * p = NULL;
+	int ret;
+
+	if (passengerUnits(type, &pU, &wU))
+	{
+		trace_elevator_request_rejected(type, start, dest, "type");
+		printk("Fail on passenger type\n");
+		return -EINVAL;
+	}
+
+	if (!validFloors(start, dest))	// Conditional statement to make sure the floor
+	{				// levels are within specifications
+		trace_elevator_request_rejected(type, start, dest, "floor");
+		printk("Fail in floor\n");
+		return -EINVAL;
+	}
+
+	ret = elevator_admit(start);
+
+	if (ret != 0)	// Over a queue or rate limit
+	{
+		trace_elevator_request_rejected(type, start, dest, (ret == -ENOMEM) ? "nomem" : "busy");
+		return ret;
+	}
+
+	p = allocPassenger();
+
+	if (p == NULL)
+	{
+		elevator_admit_leave(start);
+		trace_elevator_request_rejected(type, start, dest, "nomem");
+		printk("Fail in malloc\n");
+		return -ENOMEM;
+	}
+
+	p->passUnit = pU;	// Initializes new Passenger with parameters
+	p->weightUnit = wU;
+	p->start = start;
+	p->dest = dest;
+	p->type = type;
+	p->issueTime = ktime_get_ns();
+	p->ticket = NULL;
+	p->skipped = 0;
+	p->priority = READ_ONCE(typePriority[type - 1]);
+	p->cancelled = 0;
+	INIT_LIST_HEAD(&p->list);
+
+	*passenger = p;
+
+	return 0;
+}
+
+/*
+Hands a new passenger to the car the dispatcher picked and wakes that car.
+*/
+
+static void queuePassenger(Passenger * p, Car * car)
+{
+	trace_elevator_request_issued(car->id, p);
+
+	llist_add(&p->node, &car->arrivals);	// Hand the passenger to the car's thread, no lock needed
+
+	wake_up_interruptible(&car->wait);	// Wake the car so it picks the passenger up
+}
+
+/*
+System call that adds a new passenger to the waiting queue of the car the dispatcher picks.
+Returns 0, -EAGAIN if a queue or rate limit turned the request away, or 1 if it failed.
+*/
+extern int (*STUB_issue_request)(int,int,int);
+int my_issue_request(int type, int start, int dest)
+{
+	Passenger * p = NULL;
+	int ret;
+
+	ret = newPassenger(type, start, dest, &p);
+
+	if (ret == -EAGAIN)
+	{
+		return ret;
+	}
+	else if (ret != 0)
+	{
+		return 1;
+	}
+
+	queuePassenger(p, dispatchCar(start, dest));
+
+	return 0;
+}
+
+/*
+System call like issue_request that gives the passenger a ticket. The ticket's eventfd, if
+efd is not negative, is signalled when the passenger is picked up and again when they are
+dropped off, and wait_ticket waits for either. Returns the ticket id, or a negative error.
+*/
+extern int (*STUB_issue_ticket)(int,int,int,int);
+int my_issue_ticket(int type, int start, int dest, int efd)
+{
+	Passenger * p = NULL;
+	Car * car = NULL;
+	int ret;
+
+	ret = newPassenger(type, start, dest, &p);
+
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	car = dispatchCar(start, dest);
+	ret = elevator_ticket_new(p, car, efd);
+
+	if (ret < 0)
+	{
+		trace_elevator_request_rejected(type, start, dest, "ticket");
+		atomic_dec(&car->assigned);	// Never reached the car after all
+		elevator_admit_leave(start);
+		freePassenger(p);
+		return ret;
+	}
+
+	queuePassenger(p, car);
+
+	return ret;
+}
+
+/*
+System call that waits for a ticket to be picked up or dropped off, see
+elevator_ticket_wait.
+*/
+extern int (*STUB_wait_ticket)(int,int,u64 __user *);
+int my_wait_ticket(int ticket, int flags, u64 __user * times)
+{
+	return elevator_ticket_wait(ticket, flags, times);
+}
+
+/*
+Takes a passenger off their floor queue's counts and lets the scheduler know. The hall call
+is cleared once nobody is left waiting on the floor, so the car no longer stops there.
+Called with the car's queueMutex held.
+*/
+
+static void uncountWaiting(Car * car, Passenger * p)
+{
+	queueCount(car, p, -1);
+
+	if (car->ops->on_request_cancel != NULL)
+	{
+		car->ops->on_request_cancel(car, p);
+	}
+
+	if (car->queue.floorSize[p->start - 1] == 0)
+	{
+		__clear_bit(p->start - 1, car->queue.hallCalls);
+	}
+}
+
+/*
+Returns true if a passenger handed to car is still on its arrivals list rather than on a
+floor queue. Called with the car's queueMutex held, which the car's thread holds while it
+takes passengers off the list, and the system calls only ever push onto the front of it, so
+the rest of the list stays as it is while it is walked.
+*/
+
+static int onArrivals(Car * car, Passenger * p)
+{
+	struct llist_node * node;
+
+	for (node = READ_ONCE(car->arrivals.first); node != NULL; node = node->next)
+	{
+		if (node == &p->node)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Locks the queue of the car a ticket was given to and returns its passenger if they are still
+waiting, setting arriving if the car's thread has not moved them from its arrivals list to
+a floor queue yet. The car's thread stays the only one to take passengers off that list, so
+this never waits for it. Returns NULL with err set, and the queue unlocked, otherwise.
+*/
+
+static Passenger * lockWaiting(int ticket, Car ** carp, int * arriving, int * err)
+{
+	Car * car = elevator_ticket_car(ticket);
+	Passenger * p;
+
+	if (car == NULL)
+	{
+		*err = -ENOENT;
+		return NULL;
+	}
+
+	mutex_lock(&car->queueMutex);
+
+	p = elevator_ticket_waiting(ticket, car, err);
+
+	if (p == NULL)
+	{
+		mutex_unlock(&car->queueMutex);
+		return NULL;
+	}
+
+	*carp = car;
+	*arriving = onArrivals(car, p);
+
+	return p;
+}
+
+/*
+System call that takes a ticket's passenger off their floor queue if they have not been
+picked up yet, and drops the ticket. A passenger the car has not queued yet is marked so
+that the car's thread frees them instead. Returns 0, -ENOENT if there is no such ticket, or
+-EBUSY if the passenger is already aboard.
+*/
+extern int (*STUB_cancel_request)(int);
+int my_cancel_request(int ticket)
+{
+	Passenger * p;
+	Car * car = NULL;
+	int arriving = 0;
+	int err = 0;
+
+	p = lockWaiting(ticket, &car, &arriving, &err);
+
+	if (p == NULL)
+	{
+		return err;
+	}
+
+	if (arriving)				// drainArrivals frees them
+	{
+		p->cancelled = 1;
+	}
+	else
+	{
+		list_del(&p->list);
+		uncountWaiting(car, p);
+	}
+
+	atomic_dec(&car->assigned);		// No longer counts for dispatch
+	elevator_admit_leave(p->start);		// or against the queue limits
+
+	trace_elevator_passenger_cancelled(car, p);
+
+	elevator_ticket_cancel(p);
+
+	checkQueueTotals(car);			// Debug builds check the running totals
+	publishFloors(car);			// Update the status snapshot
+
+	mutex_unlock(&car->queueMutex);
+
+	if (!arriving)
+	{
+		freePassenger(p);
+	}
+
+	return 0;
+}
+
+/*
+System call that sends a ticket's passenger somewhere else if they have not been picked up
+yet. They keep their place in the queue unless the new floor is the other way; a passenger
+the car has not queued yet is queued for the new floor when it does. Returns 0, -EINVAL if
+dest is not a floor they can go to, -ENOENT if there is no such ticket, or -EBUSY if the
+passenger is already aboard.
+*/
+extern int (*STUB_change_destination)(int,int);
+int my_change_destination(int ticket, int dest)
+{
+	Passenger * p;
+	Car * car = NULL;
+	int up;
+	int arriving = 0;
+	int err = 0;
+
+	p = lockWaiting(ticket, &car, &arriving, &err);
+
+	if (p == NULL)
+	{
+		return err;
+	}
+
+	if (!validFloors(p->start, dest))
+	{
+		mutex_unlock(&car->queueMutex);
+		return -EINVAL;
+	}
+
+	if (arriving)	// Not counted anywhere yet, so drainArrivals queues them for dest
+	{
+		p->dest = dest;
+	}
+	else
+	{
+		up = (p->dest > p->start);
+
+		uncountWaiting(car, p);
+		p->dest = dest;
+
+		if (up != (p->dest > p->start))	// Now going the other way
+		{
+			list_move_tail(&p->list, arrivalQueue(car, p));
+		}
+
+		countArrival(car, p);
+	}
+
+	trace_elevator_passenger_rerouted(car, p);
+
+	checkQueueTotals(car);			// Debug builds check the running totals
+	publishFloors(car);			// Update the status snapshot
+
+	mutex_unlock(&car->queueMutex);
+
+	return 0;
+}
+
+/*
+System call that adds a whole array of passengers to the waiting queues. Every request is
+checked and its passenger allocated first, then each car is handed the passengers the
+dispatcher gave it with a single push onto its arrivals list. status, if not NULL, gets what
+issue_request would have returned for each entry. Returns the number of passengers
+accepted, or a negative error if the arrays could not be copied, in which case nobody was
+queued. status is checked for writing before anyone is queued, so once they are the count
+is returned even if filling it in fails after all.
+*/
+extern int (*STUB_issue_requests)(const void __user *, int, int __user *);
+int my_issue_requests(const void __user * requests, int count, int __user * status)
+{
+	struct elevator_request * req = NULL;
+	Passenger ** batch = NULL;
+	int * result = NULL;
+	struct llist_node ** newest = NULL;	// Each car's chain of passengers, newest first
+	struct llist_node ** oldest = NULL;
+	Car * car;
+
+	int pU, wU;
+	u64 now;
+	int wanted = 0;
+	int got;
+	int accepted = 0;
+	int i, j;
+
+	if ((count <= 0) || (count > ISSUE_BATCH_MAX))
+	{
+		return -EINVAL;
+	}
+
+	req = kmalloc_array(count, sizeof(*req), GFP_KERNEL);
+	batch = kmalloc_array(count, sizeof(*batch), GFP_KERNEL);
+	result = kmalloc_array(count, sizeof(*result), GFP_KERNEL);
+	newest = kcalloc(numCars, sizeof(*newest), GFP_KERNEL);
+	oldest = kcalloc(numCars, sizeof(*oldest), GFP_KERNEL);
+
+	if ((req == NULL) || (batch == NULL) || (result == NULL) || (newest == NULL) || (oldest == NULL))
+	{
+		accepted = -ENOMEM;
+		goto out;
+	}
+
+	if (copy_from_user(req, requests, count * sizeof(*req)))
+	{
+		accepted = -EFAULT;
+		goto out;
+	}
+
+	if ((status != NULL) && clear_user(status, count * sizeof(*result)))	// Fail before queuing anyone
+	{
+		accepted = -EFAULT;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++)	// Check every request before allocating anything
+	{
+		result[i] = (passengerUnits(req[i].type, &pU, &wU) || !validFloors(req[i].start, req[i].dest));
+
+		if (result[i] != 0)
+		{
+			trace_elevator_request_rejected(req[i].type, req[i].start, req[i].dest, "invalid");
+		}
+		else if ((result[i] = elevator_admit(req[i].start)) != 0)	// Over a queue or rate limit
+		{
+			trace_elevator_request_rejected(req[i].type, req[i].start, req[i].dest,
+				(result[i] == -ENOMEM) ? "nomem" : "busy");
+		}
+		else
+		{
+			wanted++;
+		}
+	}
+
+	got = allocPassengers(batch, wanted);	// Allocate the valid ones in one pass
+	now = ktime_get_ns();
+
+	for (i = 0, j = 0; i < count; i++)	// Fill in passengers and chain them up by car in order
+	{
+		if (result[i] != 0)
+		{
+			continue;
+		}
+
+		if (j == got)	// Ran out of memory for the rest
+		{
+			elevator_admit_leave(req[i].start);
+			trace_elevator_request_rejected(req[i].type, req[i].start, req[i].dest, "nomem");
+			result[i] = 1;
+			continue;
+		}
+
+		passengerUnits(req[i].type, &pU, &wU);
+
+		batch[j]->passUnit = pU;
+		batch[j]->weightUnit = wU;
+		batch[j]->start = req[i].start;
+		batch[j]->dest = req[i].dest;
+		batch[j]->type = req[i].type;
+		batch[j]->issueTime = now;
+		batch[j]->ticket = NULL;
+		batch[j]->skipped = 0;
+		batch[j]->priority = READ_ONCE(typePriority[req[i].type - 1]);
+		batch[j]->cancelled = 0;
+		INIT_LIST_HEAD(&batch[j]->list);
+
+		car = dispatchCar(req[i].start, req[i].dest);
+		trace_elevator_request_issued(car->id, batch[j]);
+
+		if (oldest[car->id] == NULL)	// Newest first, the way llist keeps them
+		{
+			oldest[car->id] = &batch[j]->node;
+		}
+		batch[j]->node.next = newest[car->id];
+		newest[car->id] = &batch[j]->node;
+
+		j++;
+	}
+
+	accepted = got;
+
+	for (i = 0; i < numCars; i++)
+	{
+		if (newest[i] != NULL)
+		{
+			llist_add_batch(newest[i], oldest[i], &cars[i].arrivals);	// One push for each car
+
+			wake_up_interruptible(&cars[i].wait);	// Wake the car so it picks them up
+		}
+	}
+
+	// Everyone is queued by now, so the count is returned even if this fails; an error would
+	// have the caller issue them all again
+	if ((status != NULL) && copy_to_user(status, result, count * sizeof(*result)))
+	{
+		pr_debug("issue_requests: status became unwritable after queuing\n");
+	}
+
+out:
+	kfree(req);
+	kfree(batch);
+	kfree(result);
+	kfree(newest);
+	kfree(oldest);
+
+	return accepted;
+}
+
+/*
+System call to stop elevator. Every car drops off the passengers it has aboard and goes
+OFFLINE. Returns 0 if any car was stopped, 1 if they had all been stopped already.
+*/
+extern int (*STUB_stop_elevator)(void);
+int my_stop_elevator(void)
+{
+	int temp = 1;
+	int i;
+
+	for (i = 0; i < numCars; i++)
+	{
+		mutex_lock(&cars[i].elevatorMutex);	// Lock mutex
+
+		if (cars[i].elevator.stop_call == 0)	// Turn on stop variable if not already on
+		{
+			cars[i].elevator.stop_call = 1;
+			trace_elevator_stop_requested(&cars[i]);
+			temp = 0;
+		}
+
+		mutex_unlock(&cars[i].elevatorMutex);	// Unlock mutex
+
+		wake_up_interruptible(&cars[i].wait);	// Cut short any idle, dwell or travel wait
+	}
+
+	return temp;
+}
+
+
+/*
+Switches the scheduling policy while the elevator is running, without draining it. The cars
+are switched one at a time, each with both of its mutexes held so its thread never sees the
+policy change halfway through a decision. Returns -EINVAL if there is no policy with that
+name.
+*/
+int elevator_set_sched(const char * name)
+{
+	struct elevator_sched_ops * ops = elevator_find_sched(name);
+	Car * car;
+	int i;
+
+	if (ops == NULL)
+	{
+		return -EINVAL;
+	}
+
+	mutex_lock(&schedMutex);
+
+	for (i = 0; i < numCars; i++)
+	{
+		car = &cars[i];
+
+		mutex_lock(&car->elevatorMutex);	// Lock mutexes
+		mutex_lock(&car->queueMutex);
+
+		if (ops->attach != NULL)	// Let the new policy catch up with the car's queue
+		{
+			ops->attach(car);
+		}
+		car->ops = ops;
+		publishElevator(car);
+
+		mutex_unlock(&car->queueMutex);	// Unlock mutexes
+		mutex_unlock(&car->elevatorMutex);
+	}
+
+	schedOps = ops;
+
+	mutex_unlock(&schedMutex);
+
+	printk(KERN_NOTICE "Elevator: scheduling policy is now %s\n", ops->name);
+
+	return 0;
+}
+EXPORT_SYMBOL(elevator_set_sched);
+
+/****************************************************************************************/
+
+/*
+Sets up one car, OFFLINE on the first floor with nobody waiting, running the policy in
+schedOps. Returns -ENOMEM if its floors could not be allocated.
+*/
+static int initCar(Car * car, int id)
+{
+	car->id = id;
+
+	if ((allocFloors(car) != 0) || (elevator_sched_init(car) != 0))	// Size the per floor arrays
+	{
+		freeFloors(car);
+		return -ENOMEM;
+	}
+
+	mutex_init(&car->elevatorMutex);	// Initialize mutexes
+	mutex_init(&car->queueMutex);
+
+	init_waitqueue_head(&car->wait);	// Initialize wait queue and arrivals
+	init_llist_head(&car->arrivals);
+	atomic_set(&car->assigned, 0);
+	seqlock_init(&car->statusLock);
+	car->thread = NULL;
+
+	mutex_lock(&car->elevatorMutex);	// Lock elevator mutex
+
+	car->elevator.state = 0;		// Initialize elevator variables
+	car->elevator.currFloor = 1;
+	car->elevator.destFloor = 1;
+	car->elevator.passUnit = 0;
+	car->elevator.weightUnit = 0;
+	car->elevator.stop_call = 0;
+	memset(&car->elevator.stats, 0, sizeof(car->elevator.stats));	// Starts out OFFLINE from now
+	car->elevator.stats.stateSince = ktime_get_ns();
+
+	mutex_lock(&car->queueMutex);	// lock queue mutex
+
+	car->queue.size = 0;		// Per floor counters, bitmaps and lists start empty from allocFloors
+	car->queue.passUnit = 0;
+	car->queue.weightUnit = 0;
+
+	car->ops = schedOps;
+	if (car->ops->attach != NULL)
+	{
+		car->ops->attach(car);
+	}
+
+	publishFloors(car);	// Publish the starting state
+	publishElevator(car);
+
+	mutex_unlock(&car->queueMutex);	// Unlock mutexes
+	mutex_unlock(&car->elevatorMutex);
+
+	return 0;
+}
+
+/*
+Stops a car's thread and frees everyone still riding or waiting in it, then the car's floors.
+*/
+static void exitCar(Car * car)
+{
+	struct task_struct * thread;
+	int i;
+
+	mutex_lock(&car->elevatorMutex);
+
+	thread = car->thread;
+	car->thread = NULL;
+
+	mutex_unlock(&car->elevatorMutex);
+
+	if (thread != NULL)	// Stop the car's thread, waking it from any wait
+	{
+		kthread_stop(thread);
+	}
+
+	mutex_lock(&car->queueMutex);	// Queue any arrivals so they are freed with the rest
+	drainArrivals(car);
+	mutex_unlock(&car->queueMutex);
+
+	for (i = 0; i < numFloors; i++)
+	{
+		freeList(&car->elevator.list[i]);
+		freeList(&car->queue.up[i]);
+		freeList(&car->queue.down[i]);
+	}
+
+	elevator_sched_exit(car);
+	freeFloors(car);
+
+	mutex_destroy(&car->elevatorMutex);
+	mutex_destroy(&car->queueMutex);
+}
+
+/*
+Module initialization
+*/
+static int elevator_init(void)
+{
+	struct elevator_sched_ops * ops = elevator_find_sched(sched);	// Pick the scheduling policy
+	int i;
+
+	if (ops == NULL)
+	{
+		printk(KERN_ERR "Elevator: unknown scheduling policy %s\n", sched);
+		return -EINVAL;
+	}
+
+	if (strcmp(boarding, "fill") == 0)	// And the boarding order
+	{
+		fillBoarding = 1;
+	}
+	else if (strcmp(boarding, "fifo") != 0)
+	{
+		printk(KERN_ERR "Elevator: unknown boarding order %s\n", boarding);
+		return -EINVAL;
+	}
+
+	if (!validGeometry())	// Check the building and car parameters
+	{
+		printk(KERN_ERR "Elevator: floors, cars, max_pass, max_weight or passenger units out of range\n");
+		return -EINVAL;
+	}
+
+	schedOps = ops;
+
+	if (elevator_latency_init() != 0)	// Allocate the per floor latency histograms
+	{
+		printk(KERN_ERR "Elevator: could not allocate latency histograms\n");
+		return -ENOMEM;
+	}
+
+	if (elevator_admit_init() != 0)	// And the per floor admission counts
+	{
+		printk(KERN_ERR "Elevator: could not allocate admission counts\n");
+		elevator_latency_exit();
+		return -ENOMEM;
+	}
+
+	passengerCache = kmem_cache_create("elevator_passenger", sizeof(Passenger), 0, SLAB_HWCACHE_ALIGN, NULL);
+
+	if (passengerCache == NULL)	// Create the passenger slab cache and free list
+	{
+		printk(KERN_ERR "Elevator: could not create passenger cache\n");
+		elevator_admit_exit();
+		elevator_latency_exit();
+		return -ENOMEM;
+	}
+
+	elevator_ticket_init();
+
+	INIT_LIST_HEAD(&passengerPool);
+	spin_lock_init(&poolLock);
+	memset(&passengerStats, 0, sizeof(passengerStats));
+
+	cars = kcalloc(numCars, sizeof(Car), GFP_KERNEL);	// Set up the cars
+
+	for (i = 0; (cars != NULL) && (i < numCars); i++)
+	{
+		if (initCar(&cars[i], i) != 0)
+		{
+			while (i-- > 0)
+			{
+				exitCar(&cars[i]);
+			}
+
+			kfree(cars);
+			cars = NULL;
+		}
+	}
+
+	if (cars == NULL)
+	{
+		printk(KERN_ERR "Elevator: could not allocate %d cars of %d floors\n", numCars, numFloors);
+		kmem_cache_destroy(passengerCache);
+		elevator_admit_exit();
+		elevator_latency_exit();
+		return -ENOMEM;
+	}
+
+	if (elevator_dev_init() != 0)	// Create /dev/elevator and its status page
+	{
+		printk(KERN_ERR "Elevator: could not create /dev/elevator\n");
+		for (i = 0; i < numCars; i++)
+		{
+			exitCar(&cars[i]);
+		}
+		kfree(cars);
+		kmem_cache_destroy(passengerCache);
+		elevator_admit_exit();
+		elevator_latency_exit();
+		return -ENOMEM;
+	}
+
+	if (elevator_sysfs_init() != 0)	// Create /sys/kernel/elevator
+	{
+		printk(KERN_ERR "Elevator: could not create /sys/kernel/elevator\n");
+		elevator_dev_exit();
+		for (i = 0; i < numCars; i++)
+		{
+			exitCar(&cars[i]);
+		}
+		kfree(cars);
+		kmem_cache_destroy(passengerCache);
+		elevator_admit_exit();
+		elevator_latency_exit();
+		return -ENOMEM;
+	}
+
+	STUB_start_elevator = my_start_elevator;	// Assign system call stubs once everything is set up
+	STUB_issue_request = my_issue_request;
+	STUB_stop_elevator = my_stop_elevator;
+	STUB_issue_requests = my_issue_requests;
+	STUB_issue_ticket = my_issue_ticket;
+	STUB_wait_ticket = my_wait_ticket;
+	STUB_cancel_request = my_cancel_request;
+	STUB_change_destination = my_change_destination;
+
+	printk(KERN_ALERT "Elevator Initialized!\n");
+
+	return 0;
+}
+
+module_init(elevator_init);
+
+/*
+Module exit function
+*/
+static void elevator_exit(void)
+{
+	int i;
+
+	STUB_start_elevator = NULL;
+	STUB_issue_request = NULL;
+	STUB_stop_elevator = NULL;
+	STUB_issue_requests = NULL;
+	STUB_issue_ticket = NULL;
+	STUB_wait_ticket = NULL;
+	STUB_cancel_request = NULL;
+	STUB_change_destination = NULL;
+
+	elevator_sysfs_exit();		// Nobody reads the cars through sysfs any more
+
+	for (i = 0; i < numCars; i++)	// Stop every car and free anyone still riding or waiting
+	{
+		exitCar(&cars[i]);
+	}
+	kfree(cars);
+
+	elevator_ticket_exit();		// No passenger points at a ticket any more
+	elevator_dev_exit();		// Nothing publishes to the status page any more
+
+	freeList(&passengerPool);	// Then the pool
+
+	kmem_cache_destroy(passengerCache);
+
+	elevator_admit_exit();
+	elevator_latency_exit();
+
+	printk(KERN_ALERT "Elevator Stopping!\n");
+}
+
+module_exit(elevator_exit);
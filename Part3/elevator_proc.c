@@ -6,8 +6,15 @@
 #include <linux/uaccess.h>
 #include <linux/time.h>
 #include <linux/list.h>
+#include <linux/seqlock.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 
 #include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_latency.h"
+#include "elevator_admit.h"
 
 #define start 335
 #define issue 336
@@ -17,159 +24,369 @@ MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Simple module featuring proc read");
 
 #define ENTRY_NAME "elevator"
-#define ENTRY_SIZE 1000
+#define ENTRY_SIZE 1000		// Report size without the cars and floors
+#define ENTRY_CAR_SIZE 500	// Report size of each car
+#define ENTRY_FLOOR_SIZE 100	// Report size of each floor
 #define PERMS 0644
 #define PARENT NULL
 static struct file_operations fops;
 
-static char *message;
-static int read_p;
+#define SCHED_ENTRY_NAME "elevator_sched"
+#define SCHED_ENTRY_SIZE 100
+static struct file_operations sched_fops;
 
-extern struct Elevator elevator;
-extern struct Queue passQueue;
+#define LATENCY_ENTRY_NAME "elevator_latency"
+#define LATENCY_LINE_SIZE 80	// Report size of each histogram
+static struct file_operations latency_fops;
 
-extern struct mutex elevatorMutex;
-extern struct mutex queueMutex;
+extern struct PassengerStats passengerStats;
 
 /**********************************************************************************************/
 
 /*
-Function that returns the total weight of a floor
+Tenths of a second a car has spent in a state, counting the time it has been in its
+current state so far.
 */
-int getFloorWeight(const int i)
+static u64 stateTenths(struct ElevatorStatus *status, int state, u64 now)
 {
-	struct list_head * temp;
-	struct list_head * dummy;
-	Passenger * passenger;
+	u64 ns = status->stats.stateTime[state];
 
-	int wU = 0;
+	if (state == status->state)
+		ns += now - status->stats.stateSince;
 
-	list_for_each_safe(temp, dummy, &passQueue.list[i])
-	{
-		passenger = list_entry(temp, Passenger, list);
-
-		wU += passenger->weightUnit;
-	}
-
-	return wU;
+	return div_u64(ns, NSEC_PER_SEC / 10);
 }
 
 /*
-Function that returns the total passenger unit of a floor
+Average load of a car over the floors it has travelled, as a percentage of limit.
 */
-int getFloorPassenger(const int i)
+static int loadPercent(u64 unitFloors, long floors, int limit)
 {
-        struct list_head * temp;
-        struct list_head * dummy;
-        Passenger * passenger;
-
-        int pU = 0;
-
-        list_for_each_safe(temp, dummy, &passQueue.list[i])
-        {
-                passenger = list_entry(temp, Passenger, list);
-
-                pU += passenger->passUnit;
-        }
+	if (floors == 0)
+		return 0;
 
-        return pU;
+	return div64_u64(unitFloors * 100, (u64) floors * limit);
 }
 
 /*
-Function that returns a character string of the elevator statistics
+Function that writes a summary of the elevator statistics into buffer, which holds size
+characters, from copies of the status snapshots of count cars, and returns its length. Each
+car gets its own section, and each floor shows the load waiting and the passengers
+serviced across all the cars.
 */
-char * printElevator(void)
+int printElevator(char * buffer, int size, struct ElevatorStatus ** status, int count)
 {
-	char *buffer = kmalloc(sizeof(char) * ENTRY_SIZE, __GFP_RECLAIM | __GFP_IO | __GFP_FS);
-	int i;
+	int len = 0;
+	int i, c;
 	int integer, decimal;
+	int passUnit, weightUnit, serviced;
+	u64 now = ktime_get_ns();
+	u64 tenths[NUM_STATES];
+	CarStats *stats;
+	long floors;
 
-	switch (elevator.state)		// Switch statement for elevator state
+	len += scnprintf(buffer + len, size - len, "Scheduling policy: %s\n", status[0]->policy);	// Prints scheduling policy
+
+	for (c = 0; c < count; c++)	// For loop to print the state of each car
 	{
-		case 0:
-			sprintf(buffer, "Elevator state: OFFLINE\n");
-			break;
-		case 1:
-                        sprintf(buffer, "Elevator state: IDLE\n");
-			break;
-		case 2:
-                        sprintf(buffer, "Elevator state: LOADING\n");
-			break;
-		case 3:
-                        sprintf(buffer, "Elevator state: UP\n");
-			break;
-		case 4:
-                        sprintf(buffer, "Elevator state: DOWN\n");
-			break;
-		default:
-			break;
+		len += scnprintf(buffer + len, size - len, "Car %d:\n", c + 1);
+
+		switch (status[c]->state)		// Switch statement for elevator state
+		{
+			case 0:
+				len += scnprintf(buffer + len, size - len, "\tElevator state: OFFLINE\n");
+				break;
+			case 1:
+				len += scnprintf(buffer + len, size - len, "\tElevator state: IDLE\n");
+				break;
+			case 2:
+				len += scnprintf(buffer + len, size - len, "\tElevator state: LOADING\n");
+				break;
+			case 3:
+				len += scnprintf(buffer + len, size - len, "\tElevator state: UP\n");
+				break;
+			case 4:
+				len += scnprintf(buffer + len, size - len, "\tElevator state: DOWN\n");
+				break;
+			default:
+				break;
+		}
+
+		len += scnprintf(buffer + len, size - len, "\tCurrent floor: %d\n", status[c]->currFloor);	// Prints current floor
+		len += scnprintf(buffer + len, size - len, "\tDestination floor: %d\n", status[c]->destFloor);	// Prints next floor
+		len += scnprintf(buffer + len, size - len, "\tCurrent passenger load: %d\n", status[c]->passUnit);	// Prints current passenger load of the car
+
+		integer = status[c]->weightUnit / 10;
+		decimal = status[c]->weightUnit % 10;
+
+		len += scnprintf(buffer + len, size - len, "\tCurrent weight load: %d.%d\n", integer, decimal);	// Prints current weight load of car
+
+		stats = &status[c]->stats;
+		floors = stats->floorsLoaded + stats->floorsEmpty;
+
+		for (i = 0; i < NUM_STATES; i++)
+			tenths[i] = stateTenths(status[c], i, now);
+
+		len += scnprintf(buffer + len, size - len,	// Prints how long the car has spent in each state
+			"\tSeconds offline/idle/loading/up/down: %llu.%llu/%llu.%llu/%llu.%llu/%llu.%llu/%llu.%llu\n",
+			tenths[OFFLINE] / 10, tenths[OFFLINE] % 10, tenths[IDLE] / 10, tenths[IDLE] % 10,
+			tenths[LOADING] / 10, tenths[LOADING] % 10, tenths[UP] / 10, tenths[UP] % 10,
+			tenths[DOWN] / 10, tenths[DOWN] % 10);
+		len += scnprintf(buffer + len, size - len, "\tFloors travelled: %ld loaded, %ld empty\n",
+			stats->floorsLoaded, stats->floorsEmpty);
+		len += scnprintf(buffer + len, size - len, "\tStops: %ld, %ld with nobody getting on or off\n",
+			stats->stops, stats->uselessStops);
+		len += scnprintf(buffer + len, size - len, "\tAverage load while moving: %d%% passengers, %d%% weight\n",
+			loadPercent(stats->passFloors, floors, status[c]->maxPass),
+			loadPercent(stats->weightFloors, floors, status[c]->maxWeight));
 	}
 
-	sprintf(buffer + strlen(buffer), "Current floor: %d\n", elevator.currFloor);	// Prints current floor
-	sprintf(buffer + strlen(buffer), "Destination floor: %d\n", elevator.destFloor);	// Prints next floor
-	sprintf(buffer + strlen(buffer), "Current passenger load: %d\n", elevator.passUnit);	// Prints current passenger load of the elevator
+	len += scnprintf(buffer + len, size - len, "*********************************************\n");
 
-	integer = elevator.weightUnit / 10;
-	decimal = elevator.weightUnit % 10;
+	for (i = status[0]->floors; i > 0; i--)	// For loop to print statistics of each floor
+	{
+		passUnit = weightUnit = serviced = 0;
 
-	sprintf(buffer + strlen(buffer), "Current weight load: %d.%d\n", integer, decimal);	// Prints current weight load of elevator
+		for (c = 0; c < count; c++)	// Add up the floor over the cars
+		{
+			passUnit += status[c]->floor[i - 1].passUnit;
+			weightUnit += status[c]->floor[i - 1].weightUnit;
+			serviced += status[c]->floor[i - 1].serviced;
+		}
 
-	sprintf(buffer + strlen(buffer), "*********************************************\n");
+		len += scnprintf(buffer + len, size - len, "Floor %d:\n", i);	// Floor number
+		len += scnprintf(buffer + len, size - len, "\tPassenger load: %d\n", passUnit);	// Prints passenger unit of floor
 
-	for (i = 10; i > 0; i--)	// For loop to print statistics of each floor
-	{
-		sprintf(buffer + strlen(buffer), "Floor %d:\n", i);	// Floor number
-		sprintf(buffer + strlen(buffer), "\tPassenger load: %d\n", getFloorPassenger(i - 1));	// Prints passenger unit of floor
+	        integer = weightUnit / 10;
+	        decimal = weightUnit % 10;
 
-	        integer = getFloorWeight(i - 1) / 10;
-	        decimal = getFloorWeight(i - 1) % 10;
-
-		sprintf(buffer + strlen(buffer), "\tWeight load: %d.%d\n", integer, decimal);	// Prints weight unit of floor
-		sprintf(buffer + strlen(buffer), "\tPassengers serviced: %d\n", elevator.passServiced[i - 1]);	// Prints number of people serviced for that floor
+		len += scnprintf(buffer + len, size - len, "\tWeight load: %d.%d\n", integer, decimal);	// Prints weight unit of floor
+		len += scnprintf(buffer + len, size - len, "\tPassengers serviced: %d\n", serviced);	// Prints number of people serviced for that floor
 	}
 
-	return buffer;	// Return full summary
+	len += scnprintf(buffer + len, size - len, "*********************************************\n");
+
+	len += scnprintf(buffer + len, size - len, "Passenger objects: %d live (peak %d), %d pooled (peak %d)\n",	// Prints passenger allocation counts
+		passengerStats.live, passengerStats.livePeak, passengerStats.pooled, passengerStats.pooledPeak);
+	len += scnprintf(buffer + len, size - len, "Passenger allocations: %ld from slab, %ld reused\n",
+		passengerStats.slabAllocs, passengerStats.poolAllocs);
+	len += scnprintf(buffer + len, size - len, "Admission: %d waiting, turned away %ld queue full, %ld floor full, %ld over rate\n",
+		atomic_read(&admitStats.waiting), atomic_long_read(&admitStats.queueRejects),
+		atomic_long_read(&admitStats.floorRejects), atomic_long_read(&admitStats.rateRejects));
+
+	return len;	// Return length of full summary
 }
 
 /***************************************************************************************************/
 
 int elevator_proc_open(struct inode *sp_inode, struct file *sp_file) {
-	printk(KERN_INFO "proc called open\n");
+	struct ElevatorStatus **status;
+	char *message;
+	char *copies;
+	int floors = cars[0].status->floors;	// Fixed once the module is loaded
+	int size = ENTRY_SIZE + numCars * ENTRY_CAR_SIZE + floors * ENTRY_FLOOR_SIZE;
+	unsigned int seq;
+	int c;
 
-	read_p = 1;
+	printk(KERN_INFO "proc called open\n");
 
-        message = kmalloc(sizeof(char) * ENTRY_SIZE, __GFP_RECLAIM | __GFP_IO | __GFP_FS);	// Allocate space for message
-        if (message == NULL) {
+        message = kvmalloc(sizeof(char) * size, GFP_KERNEL);	// Allocate space for message
+        status = kmalloc_array(numCars, sizeof(*status), GFP_KERNEL);
+        copies = kvmalloc_array(numCars, STATUS_SIZE(floors), GFP_KERNEL);
+        if (message == NULL || status == NULL || copies == NULL) {
                 printk(KERN_WARNING "elevator_proc_open");
+                kvfree(message);
+                kfree(status);
+                kvfree(copies);
                 return -ENOMEM;
         }
 
-	mutex_lock(&elevatorMutex);	// Lock mutexes
-	mutex_lock(&queueMutex);
+	for (c = 0; c < numCars; c++) {
+		status[c] = (struct ElevatorStatus *) (copies + c * STATUS_SIZE(floors));
 
-	sprintf(message, printElevator());	// Copy elevator summary to message to be printed
+		do {	// Copy the car's status snapshot, trying again if the car changed it meanwhile
+			seq = read_seqbegin(&cars[c].statusLock);
+			memcpy(status[c], cars[c].status, STATUS_SIZE(floors));
+		} while (read_seqretry(&cars[c].statusLock, seq));
+	}
 
-	mutex_unlock(&elevatorMutex);	// Unlock mutex
-	mutex_unlock(&queueMutex);
+	printElevator(message, size, status, numCars);	// Write elevator summary to message to be printed
 
+	kfree(status);
+	kvfree(copies);
+	sp_file->private_data = message;	// Each open reads its own copy
 	return 0;
 }
 
 ssize_t elevator_proc_read(struct file *sp_file, char __user *buf, size_t size, loff_t *offset) {
-	int len = strlen(message);
-
-	read_p = !read_p;
-	if (read_p)
-		return 0;
+	char *message = sp_file->private_data;
 
 	printk(KERN_INFO "proc called read\n");
-	copy_to_user(buf, message, len);
-	return len;
+	return simple_read_from_buffer(buf, size, offset, message, strlen(message));	// Tall buildings may take several reads
 }
 
 int elevator_proc_release(struct inode *sp_inode, struct file *sp_file) {
 	printk(KERN_NOTICE "proc called release\n");
-	kfree(message);
+	kvfree(sp_file->private_data);
+	return 0;
+}
+
+/***************************************************************************************************/
+
+/*
+Reading /proc/elevator_sched lists the scheduling policies with the active one in brackets.
+Writing a policy name to it switches the elevator over to that policy.
+*/
+
+ssize_t elevator_sched_read(struct file *sp_file, char __user *buf, size_t size, loff_t *offset) {
+	char list[SCHED_ENTRY_SIZE];
+	int len = 0;
+	int i;
+
+	for (i = 0; schedPolicies[i] != NULL; i++) {
+		if (schedPolicies[i] == schedOps)
+			len += scnprintf(list + len, sizeof(list) - len, "[%s] ", schedPolicies[i]->name);
+		else
+			len += scnprintf(list + len, sizeof(list) - len, "%s ", schedPolicies[i]->name);
+	}
+	len += scnprintf(list + len, sizeof(list) - len, "\n");
+
+	return simple_read_from_buffer(buf, size, offset, list, len);
+}
+
+ssize_t elevator_sched_write(struct file *sp_file, const char __user *buf, size_t size, loff_t *offset) {
+	char name[SCHED_ENTRY_SIZE];
+	int ret;
+
+	if (size >= sizeof(name))
+		return -EINVAL;
+
+	if (copy_from_user(name, buf, size))
+		return -EFAULT;
+	name[size] = '\0';
+
+	ret = elevator_set_sched(strim(name));
+	if (ret)
+		return ret;
+
+	return size;
+}
+
+/***************************************************************************************************/
+
+/*
+Reading /proc/elevator_latency gives the number of passengers and the p50, p90, p99 and
+maximum wait, ride and trip times in milliseconds, for everyone and then by passenger type
+and start floor. Floors nobody has been picked up from are left out. Writing reset to it
+clears the histograms.
+*/
+
+static const char *latencyTypes[BELLHOP] = { "adult", "child", "room service", "bellhop" };
+
+static int printLatencyHist(char *buffer, int size, const char *group, const char *what, const struct LatencyHist *hist) {
+	return scnprintf(buffer, size, "%-14s %-5s %8u %9llu %9llu %9llu %9llu\n", group, what, hist->count,
+		(unsigned long long) elevator_latency_percentile(hist, 50) / 1000,
+		(unsigned long long) elevator_latency_percentile(hist, 90) / 1000,
+		(unsigned long long) elevator_latency_percentile(hist, 99) / 1000,
+		(unsigned long long) hist->max / 1000);
+}
+
+/*
+Copies a set of histograms under latencyLock so it can be formatted without holding the
+lock, then prints its three lines. Sets with nobody in them are skipped if skipEmpty is set.
+*/
+static int printLatencySet(char *buffer, int size, const char *group, const struct LatencySet *set,
+			   struct LatencySet *copy, int skipEmpty) {
+	int len = 0;
+
+	spin_lock(&latencyLock);
+	*copy = *set;
+	spin_unlock(&latencyLock);
+
+	if (skipEmpty && copy->trip.count == 0)
+		return 0;
+
+	len += printLatencyHist(buffer + len, size - len, group, "wait", &copy->wait);
+	len += printLatencyHist(buffer + len, size - len, group, "ride", &copy->ride);
+	len += printLatencyHist(buffer + len, size - len, group, "trip", &copy->trip);
+
+	return len;
+}
+
+int elevator_latency_open(struct inode *sp_inode, struct file *sp_file) {
+	int size = (3 * (1 + BELLHOP + numFloors) + BELLHOP + 4) * LATENCY_LINE_SIZE;
+	u32 boarded, late;
+	struct LatencySet *copy;
+	char group[16];
+	char *text;
+	int len = 0;
+	int i;
+
+	text = kvmalloc(size, GFP_KERNEL);
+	copy = kmalloc(sizeof(*copy), GFP_KERNEL);
+	if (text == NULL || copy == NULL) {
+		kvfree(text);
+		kfree(copy);
+		return -ENOMEM;
+	}
+
+	len += scnprintf(text + len, size - len, "%-14s %-5s %8s %9s %9s %9s %9s\n", "passengers", "time",
+		"count", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+	len += printLatencySet(text + len, size - len, "all", &latencyStats.all, copy, 0);
+
+	for (i = 0; i < BELLHOP; i++)
+		len += printLatencySet(text + len, size - len, latencyTypes[i], &latencyStats.type[i], copy, 1);
+
+	for (i = 0; i < numFloors; i++) {
+		scnprintf(group, sizeof(group), "floor %d", i + 1);
+		len += printLatencySet(text + len, size - len, group, &latencyStats.floor[i], copy, 1);
+	}
+
+	len += scnprintf(text + len, size - len, "\n%-14s %8s %9s %8s %8s\n", "class", "priority",
+		"target ms", "boarded", "late");
+
+	for (i = 0; i < BELLHOP; i++) {	/* How each priority class is doing against its target */
+		spin_lock(&latencyLock);
+		boarded = latencyStats.type[i].wait.count;
+		late = latencyStats.late[i];
+		spin_unlock(&latencyLock);
+
+		len += scnprintf(text + len, size - len, "%-14s %8d %9d %8u %8u\n", latencyTypes[i],
+			typePriority[i], waitTarget[i], boarded, late);
+	}
+
+	kfree(copy);
+	sp_file->private_data = text;
+	return 0;
+}
+
+ssize_t elevator_latency_read(struct file *sp_file, char __user *buf, size_t size, loff_t *offset) {
+	char *text = sp_file->private_data;
+
+	return simple_read_from_buffer(buf, size, offset, text, strlen(text));
+}
+
+ssize_t elevator_latency_write(struct file *sp_file, const char __user *buf, size_t size, loff_t *offset) {
+	char command[SCHED_ENTRY_SIZE];
+
+	if (size >= sizeof(command))
+		return -EINVAL;
+
+	if (copy_from_user(command, buf, size))
+		return -EFAULT;
+	command[size] = '\0';
+
+	if (strcmp(strim(command), "reset") != 0)
+		return -EINVAL;
+
+	elevator_latency_reset();
+
+	return size;
+}
+
+int elevator_latency_release(struct inode *sp_inode, struct file *sp_file) {
+	kvfree(sp_file->private_data);
 	return 0;
 }
 
@@ -186,12 +403,37 @@ static int elevator_init(void) {
 		remove_proc_entry(ENTRY_NAME, NULL);
 		return -ENOMEM;
 	}
+
+	printk(KERN_NOTICE "/proc/%s create\n", SCHED_ENTRY_NAME);
+	sched_fops.read = elevator_sched_read;
+	sched_fops.write = elevator_sched_write;
+
+	if (!proc_create(SCHED_ENTRY_NAME, PERMS, NULL, &sched_fops)) {
+		printk(KERN_WARNING "proc create\n");
+		remove_proc_entry(ENTRY_NAME, NULL);
+		return -ENOMEM;
+	}
+
+	printk(KERN_NOTICE "/proc/%s create\n", LATENCY_ENTRY_NAME);
+	latency_fops.open = elevator_latency_open;
+	latency_fops.read = elevator_latency_read;
+	latency_fops.write = elevator_latency_write;
+	latency_fops.release = elevator_latency_release;
+
+	if (!proc_create(LATENCY_ENTRY_NAME, PERMS, NULL, &latency_fops)) {
+		printk(KERN_WARNING "proc create\n");
+		remove_proc_entry(SCHED_ENTRY_NAME, NULL);
+		remove_proc_entry(ENTRY_NAME, NULL);
+		return -ENOMEM;
+	}
 	
 	return 0;
 }
 module_init(elevator_init);
 
 static void elevator_exit(void) {
+	remove_proc_entry(LATENCY_ENTRY_NAME, NULL);
+	remove_proc_entry(SCHED_ENTRY_NAME, NULL);
 	remove_proc_entry(ENTRY_NAME, NULL);
 	printk(KERN_NOTICE "Removing /proc/%s\n", ENTRY_NAME);
 }
@@ -0,0 +1,1279 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/list.h>
+#include <linux/bitmap.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_ticket.h"
+#include "elevator_admit.h"
+#include "elevator_latency.h"
+#include "elevator_trace.h"
+
+/**************************************************************************************************/
+
+/*
+If the elevator has reached max weight or if it has reached the maximum number of
+passengers, the the function returns true. Otherwise, it returns false.
+*/
+
+static int atMax(Car * car)
+{
+	if ((car->elevator.passUnit == maxPass) || (car->elevator.weightUnit == maxWeight))
+	{
+		return 1;
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+/*
+Returns true if the passenger would fit in the elevator.
+*/
+
+static int Fits(Car * car, Passenger * passenger)
+{
+	if (passenger->weightUnit <= maxWeight - car->elevator.weightUnit)
+	{
+		if (passenger->passUnit <= maxPass - car->elevator.passUnit)
+		{
+			return 1;
+		}
+		else
+		{
+			return 0;
+		}
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+/*
+Returns the queue of passengers waiting on the elevator's current floor to go the given way.
+*/
+
+static struct list_head * hallQueue(Car * car, int direction)
+{
+	if (direction == UP)
+	{
+		return &car->queue.up[car->elevator.currFloor - 1];
+	}
+	else
+	{
+		return &car->queue.down[car->elevator.currFloor - 1];
+	}
+}
+
+/*
+Returns true if the elevator can take passengers going the given way from the current floor.
+At the bottom and top floors everyone is going the same way, whatever the state.
+*/
+
+static int boardingWay(Car * car, int direction)
+{
+	if (direction == UP)
+	{
+		return (car->elevator.state == UP) || (car->elevator.currFloor == 1);
+	}
+	else
+	{
+		return (car->elevator.state == DOWN) || (car->elevator.currFloor == numFloors);
+	}
+}
+
+/*
+Moves one waiting passenger from the current floor's queue into the elevator and updates
+the elevator and queue counters and the car and hall call bitmaps.
+*/
+
+static void boardPassenger(Car * car, Passenger * passenger)
+{
+	int floor = car->elevator.currFloor - 1;
+
+	passenger->boardTime = ktime_get_ns();	// Their wait ends here
+	elevator_ticket_update(passenger, ELEVATOR_TICKET_PICKUP, passenger->boardTime);
+	elevator_admit_leave(passenger->start);	// No longer counts against the queue limits
+
+	list_del(&passenger->list);
+	list_add(&passenger->list, &car->elevator.list[passenger->dest - 1]);
+	__set_bit(passenger->dest - 1, car->elevator.carCalls);	// Mark the car call
+
+	car->elevator.size += 1;
+	car->elevator.passUnit += passenger->passUnit;
+	car->elevator.weightUnit += passenger->weightUnit;
+
+	trace_elevator_passenger_loaded(car, passenger);
+
+	queueCount(car, passenger, -1);
+
+	if (car->queue.floorSize[floor] == 0)	// Clear the hall call once the floor is empty
+	{
+		__clear_bit(floor, car->queue.hallCalls);
+	}
+}
+
+/*
+Fill boarding. Rather than stopping at the first passenger who does not fit, the elevator
+boards the mix of waiting passengers that carries the most passenger units within both the
+passenger and weight limits. Passengers only differ by type, so this is a knapsack over at
+most BELLHOP kinds of item. Each type's count is split into chunks of 1, 2, 4, ... and
+fillWeight[P] keeps the least weight that makes up P passenger units, so a stop costs
+O(maxPass log maxPass) however many are waiting. Within a type the longest waiting board
+first.
+*/
+
+struct FillItem
+{
+	int type;
+	int count;
+};
+
+#define FILL_NONE INT_MAX	// No mix makes up these passenger units
+
+static int fillItemsMax;	// Most chunks, BELLHOP * (ilog2(maxPass) + 2)
+
+/*
+Turns the number of passengers of each type waiting into the number of each to board, and
+the units of each type, taken from the passengers themselves.
+*/
+
+static void fillChoose(Car * car, int * count, const int * pass, const int * weight)
+{
+	int spare = maxPass - car->elevator.passUnit;
+	int spareWeight = maxWeight - car->elevator.weightUnit;
+	int stride = maxPass + 1;
+	int items = 0;
+	int i, t, P, size, chunk, avail;
+	int itemPass, itemWeight;
+
+	for (t = 0; t < BELLHOP; t++)	// Split what fits of each type into chunks
+	{
+		avail = count[t];
+
+		if (avail > 0)
+		{
+			avail = min3(avail, spare / pass[t], spareWeight / weight[t]);
+		}
+
+		for (size = 1; avail > 0; size *= 2)
+		{
+			chunk = min(size, avail);
+			car->fillItem[items].type = t;
+			car->fillItem[items].count = chunk;
+			items++;
+			avail -= chunk;
+		}
+
+		count[t] = 0;
+	}
+
+	car->fillWeight[0] = 0;
+
+	for (P = 1; P <= spare; P++)
+	{
+		car->fillWeight[P] = FILL_NONE;
+	}
+
+	for (i = 0; i < items; i++)	// 0/1 knapsack over the chunks
+	{
+		t = car->fillItem[i].type;
+		itemPass = car->fillItem[i].count * pass[t];
+		itemWeight = car->fillItem[i].count * weight[t];
+
+		bitmap_clear(car->fillChoice, i * stride, stride);
+
+		for (P = spare; P >= itemPass; P--)
+		{
+			if ((car->fillWeight[P - itemPass] != FILL_NONE) &&
+			    (car->fillWeight[P - itemPass] + itemWeight < car->fillWeight[P]))
+			{
+				car->fillWeight[P] = car->fillWeight[P - itemPass] + itemWeight;
+				__set_bit(i * stride + P, car->fillChoice);
+			}
+		}
+	}
+
+	P = spare;
+
+	while (car->fillWeight[P] > spareWeight)	// Most passenger units within the weight
+	{
+		P--;
+	}
+
+	for (i = items - 1; i >= 0; i--)	// Walk the choices back
+	{
+		if (test_bit(i * stride + P, car->fillChoice))
+		{
+			t = car->fillItem[i].type;
+			count[t] += car->fillItem[i].count;
+			P -= car->fillItem[i].count * pass[t];
+		}
+	}
+}
+
+/*
+Returns true if any passenger type has been given a priority, so boarding has to go by
+priority rather than by the order people arrived in.
+*/
+
+static int prioritiesSet(void)
+{
+	int i;
+
+	for (i = 0; i < BELLHOP; i++)
+	{
+		if (READ_ONCE(typePriority[i]) != 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Returns a waiting passenger's priority, raised by one for every priorityAging seconds they
+have been waiting.
+*/
+
+static s64 passengerPriority(Passenger * passenger, u64 now)
+{
+	int aging = READ_ONCE(priorityAging);
+	s64 level = passenger->priority;
+
+	if (aging > 0)
+	{
+		level += div_u64(now - passenger->issueTime, (u64) aging * NSEC_PER_SEC);
+	}
+
+	return level;
+}
+
+/*
+Returns the queue of passengers of one type waiting on a floor to go the given way, both
+0 based.
+*/
+
+static struct list_head * typeQueue(Car * car, int floor, int direction, int type)
+{
+	if (direction == UP)
+	{
+		return &car->queue.upType[floor * BELLHOP + type];
+	}
+	else
+	{
+		return &car->queue.downType[floor * BELLHOP + type];
+	}
+}
+
+/*
+Returns the passenger with the highest priority, aging included, of those waiting on a floor
+(0 based) to go the given way, or NULL if nobody is. Each type's queue is in the order people
+arrived, so the one at its front has waited longest and only the fronts need looking at (a
+change to type_priority reaches the rest of a type's queue as the front boards). Ties go to
+whoever came first.
+*/
+
+static Passenger * bestWaiting(Car * car, int floor, int direction, u64 now)
+{
+	struct list_head * queue;
+	Passenger * passenger = NULL;
+	Passenger * best = NULL;
+
+	s64 level, bestLevel = 0;
+	int i;
+
+	for (i = 0; i < BELLHOP; i++)
+	{
+		queue = typeQueue(car, floor, direction, i);
+
+		if (list_empty(queue))
+		{
+			continue;
+		}
+
+		passenger = list_first_entry(queue, Passenger, typeList);
+		level = passengerPriority(passenger, now);
+
+		if ((best == NULL) || (level > bestLevel) ||
+		    ((level == bestLevel) && (passenger->issueTime < best->issueTime)))
+		{
+			best = passenger;
+			bestLevel = level;
+		}
+	}
+
+	return best;
+}
+
+/*
+Returns the passenger whose turn it is to board going the given way by priority, or NULL if
+the car is full, nobody is waiting, or they do not fit. With aboveZero set, only a passenger
+whose priority is above 0 counts.
+*/
+
+static Passenger * nextByPriority(Car * car, int direction, int aboveZero, u64 now)
+{
+	Passenger * best;
+
+	if (atMax(car))
+	{
+		return NULL;
+	}
+
+	best = bestWaiting(car, car->elevator.currFloor - 1, direction, now);
+
+	if ((best == NULL) || (!Fits(car, best)) || (aboveZero && (passengerPriority(best, now) <= 0)))
+	{
+		return NULL;
+	}
+
+	return best;
+}
+
+/*
+Boards passengers going the given way highest priority first, and in the order they arrived
+within a priority. As with boardFrom, nobody jumps ahead of the passenger whose turn it is if
+they do not fit. Each passenger boarded costs a look at the front of each type's queue. With
+aboveZero set it stops at the first passenger not above priority 0, leaving the rest to
+fill boarding.
+*/
+
+static int boardByPriority(Car * car, int direction, int aboveZero)
+{
+	Passenger * best = NULL;
+
+	u64 now = ktime_get_ns();
+	int counter = 0;
+
+	while ((best = nextByPriority(car, direction, aboveZero, now)) != NULL)
+	{
+		boardPassenger(car, best);
+		counter++;
+	}
+
+	return counter;
+}
+
+/*
+Boards passengers going the given way with fill boarding. Once any type has a priority,
+those above priority 0, aging included, board first as boardByPriority would board them, and
+the rest of the room is filled from whoever is left. A passenger passed over for someone
+behind them boardSkipMax times is owed a place: owed passengers board next, in order, and if
+one does not fit nobody behind them boards at all.
+*/
+
+static int fillFrom(Car * car, int direction)
+{
+	struct list_head * queue = hallQueue(car, direction);
+	struct list_head * dummy = NULL;
+	struct list_head * temp = NULL;
+
+	Passenger * passenger = NULL;
+	Passenger * barrier = NULL;	// Owed passenger who does not fit
+
+	int count[BELLHOP] = {0};
+	int pass[BELLHOP] = {0};
+	int weight[BELLHOP] = {0};
+	int counter = 0;
+	int passed = 0;
+	int skipped = 0;
+	int t;
+
+	if (prioritiesSet())	// Priority passengers first
+	{
+		counter = boardByPriority(car, direction, 1);
+	}
+
+	list_for_each_safe(temp, dummy, queue)	// Then owed passengers
+	{
+		passenger = list_entry(temp, Passenger, list);
+
+		if (passenger->skipped < boardSkipMax)
+		{
+			continue;
+		}
+
+		if (!Fits(car, passenger))
+		{
+			barrier = passenger;
+			break;
+		}
+
+		boardPassenger(car, passenger);
+		counter++;
+	}
+
+	list_for_each_entry(passenger, queue, list)	// Count the rest by type up to the barrier
+	{
+		if (passenger == barrier)
+		{
+			break;
+		}
+
+		t = passenger->type - 1;
+		count[t] += 1;
+		pass[t] = passenger->passUnit;
+		weight[t] = passenger->weightUnit;
+	}
+
+	if (atMax(car))
+	{
+		return counter;
+	}
+
+	fillChoose(car, count, pass, weight);
+
+	list_for_each_safe(temp, dummy, queue)	// Board the chosen mix, longest waiting first
+	{
+		passenger = list_entry(temp, Passenger, list);
+
+		if (passenger == barrier)
+		{
+			break;
+		}
+
+		t = passenger->type - 1;
+
+		if (count[t] > 0)
+		{
+			count[t] -= 1;
+			boardPassenger(car, passenger);
+			counter++;
+			skipped = passed;	// Everyone passed over so far has been skipped
+		}
+		else
+		{
+			passed++;
+		}
+	}
+
+	list_for_each_entry(passenger, queue, list)	// They are still at the front, in order
+	{
+		if (skipped-- <= 0)
+		{
+			break;
+		}
+
+		passenger->skipped += 1;
+	}
+
+	return counter;
+}
+
+/*
+Boards passengers from the front of the queue for the given direction until the elevator is
+at max weight or max passenger capacity, or the passenger at the front does not fit. Nobody
+jumps ahead of a passenger who does not fit, so the work done is one step per passenger
+boarded. The number of passengers loaded is returned by the counter variable. With
+boarding=fill, fillFrom picks who boards instead, and otherwise once any type has a priority
+boardByPriority does.
+*/
+
+static int boardFrom(Car * car, int direction)
+{
+	struct list_head * queue = hallQueue(car, direction);
+	Passenger * passenger = NULL;
+
+	int counter = 0;
+
+	if (fillBoarding)
+	{
+		return fillFrom(car, direction);
+	}
+
+	if (prioritiesSet())
+	{
+		return boardByPriority(car, direction, 0);
+	}
+
+	while ((!list_empty(queue)) && (!atMax(car)))
+	{
+		passenger = list_first_entry(queue, Passenger, list);
+
+		if (!Fits(car, passenger))
+		{
+			break;
+		}
+
+		boardPassenger(car, passenger);
+		counter++;
+	}
+
+	return counter;
+}
+
+/*
+First come first served loading of everyone going the elevator's way.
+*/
+
+static int Load(Car * car)
+{
+	int counter = 0;
+
+	if (boardingWay(car, UP))
+	{
+		counter += boardFrom(car, UP);
+	}
+
+	if (boardingWay(car, DOWN))
+	{
+		counter += boardFrom(car, DOWN);
+	}
+
+	return counter;
+}
+
+/*
+This function removes passengers from the car's queue until all passengers
+whose destination is the current floor are cleared from the queue. The number of
+passengers unloaded is returned by the counter variable.
+*/
+
+int Unload(Car * car)
+{
+	struct list_head * temp = NULL;
+	struct list_head * dummy = NULL;
+
+	struct Passenger * passenger = NULL;
+
+	int counter = 0;
+	u64 now = ktime_get_ns();
+
+	list_for_each_safe(temp, dummy, &car->elevator.list[car->elevator.currFloor - 1])
+	{
+		passenger = list_entry(temp, Passenger, list);
+
+		elevator_latency_record(passenger, now);	// Record how long they waited and rode
+		elevator_ticket_update(passenger, ELEVATOR_TICKET_DROPOFF, now);
+
+		car->elevator.size -= 1;
+                car->elevator.passUnit -= passenger->passUnit;
+                car->elevator.weightUnit -= passenger->weightUnit;
+
+		trace_elevator_passenger_unloaded(car, passenger);
+
+		list_del(&passenger->list);
+		freePassenger(passenger);
+
+		counter++;
+	}
+
+	__clear_bit(car->elevator.currFloor - 1, car->elevator.carCalls);	// Nobody left aboard for this floor
+
+	if (counter > 0)	// There is room now, so anyone who did not fit before might
+	{
+		bitmap_zero(car->refusedCalls, numFloors);
+	}
+
+	atomic_sub(counter, &car->assigned);					// Delivered, so no longer count for dispatch
+
+	return counter;
+}
+
+/*
+Fills pending with every floor that has a hall call or a car call. While draining after a
+stop call only car calls count.
+*/
+
+static void pendingFloors(Car * car, unsigned long * pending, int draining)
+{
+	if (draining)
+	{
+		bitmap_copy(pending, car->elevator.carCalls, numFloors);
+	}
+	else
+	{
+		bitmap_or(pending, car->queue.hallCalls, car->elevator.carCalls, numFloors);
+	}
+}
+
+/*
+Returns true if someone is waiting on the elevator's current floor.
+*/
+
+static int hallCallHere(Car * car)
+{
+	return test_bit(car->elevator.currFloor - 1, car->queue.hallCalls);
+}
+
+/*
+Stops at every floor, as the original SCAN elevator did.
+*/
+
+static int alwaysStop(Car * car)
+{
+	return 1;
+}
+
+/**************************************************************************************************/
+
+/*
+This function takes the elevator to the next floor in the direction in which it is
+going. If the elevator is at the top and going up, then the state is changed to down;
+and if the elevator is at the bottom floor going down, the state changes to up.
+*/
+
+static void scanNextFloor(Car * car, int draining)
+{
+	if(car->elevator.state == DOWN)
+	{
+		if (car->elevator.currFloor > 1)
+		{
+			car->elevator.destFloor--;
+		}
+		else
+		{
+			car->elevator.state = UP;
+			car->elevator.destFloor++;
+		}
+	}
+	else if (car->elevator.state == UP)
+	{
+		if (car->elevator.currFloor < numFloors)
+		{
+			car->elevator.destFloor++;
+		}
+		else
+		{
+			car->elevator.state = DOWN;
+			car->elevator.destFloor--;
+		}
+	}
+	else if ((car->elevator.state == IDLE) && (car->queue.size != 0))
+	{
+		car->elevator.state = UP;
+	}
+	else if (car->elevator.state == LOADING)
+	{
+		car->elevator.state = car->elevator.prevState;
+
+		if (car->elevator.state == IDLE)	// Boarded people while idle, so set off with them
+		{
+			car->elevator.state = UP;
+		}
+	}
+}
+
+static struct elevator_sched_ops scanOps =
+{
+	.name = "scan",
+	.pick_next_floor = scanNextFloor,
+	.should_stop_here = alwaysStop,
+	.select_passengers_to_load = Load,
+};
+
+/**************************************************************************************************/
+
+/*
+Returns the closest floor above the elevator that has its bit set in pending, or 0 if there
+is none.
+*/
+
+static int nextStopAbove(Car * car, const unsigned long * pending)
+{
+	int next = find_next_bit(pending, numFloors, car->elevator.currFloor);
+
+	return (next < numFloors) ? next + 1 : 0;
+}
+
+/*
+Returns the next floor below the elevator to stop at, or 0 if there is none. Normally this
+is the closest floor below with its bit set in pending. For C-LOOK the trip down is a return
+run, so the elevator only stops to let passengers off, or to pick up people going down, on
+its way to the lowest pending floor. People going down are only ever picked up on a return
+run, so passing them by would leave them waiting for as long as up calls keep coming.
+*/
+
+static int nextStopBelow(Car * car, const unsigned long * pending, int circular)
+{
+	int floor = car->elevator.currFloor - 1;	// Bit index of the current floor
+	int next, i;
+
+	if (circular)
+	{
+		next = find_last_bit(car->elevator.carCalls, floor);
+
+		for (i = floor - 1; (i >= 0) && ((next >= floor) || (i > next)); i--)
+		{
+			if ((car->queue.downSize[i] > 0) && test_bit(i, pending))	// Not while draining
+			{
+				next = i;
+				break;
+			}
+		}
+
+		if (next >= floor)
+		{
+			next = find_first_bit(pending, floor);
+		}
+	}
+	else
+	{
+		next = find_last_bit(pending, floor);
+	}
+
+	return (next < floor) ? next + 1 : 0;
+}
+
+/*
+LOOK and C-LOOK. The next stop is looked up in the pending bitmap, and the elevator turns
+around at the last floor that needs service instead of running to the end of the building.
+When turning around at a floor that still has people waiting, the elevator stays put so
+they can board in the new direction. An elevator that boarded people while idle picks its
+direction as soon as it has finished loading, rather than staying idle with them aboard.
+Leaving LOADING or IDLE picks the next stop in the same call, so the car sets off straight
+away instead of going round its loop once more first.
+*/
+
+static void lookNextFloor(Car * car, const unsigned long * pending, int circular)
+{
+	int here = test_bit(car->elevator.currFloor - 1, pending);
+	int stop;
+
+	if (car->elevator.state == LOADING)
+	{
+		car->elevator.state = car->elevator.prevState;
+	}
+
+	if (car->elevator.state == IDLE)
+	{
+		if (bitmap_empty(pending, numFloors))
+		{
+			return;
+		}
+
+		if (here)	// Load here first, then head on up
+		{
+			car->elevator.state = UP;
+			car->elevator.destFloor = car->elevator.currFloor;
+			return;
+		}
+
+		car->elevator.state = (nextStopAbove(car, pending) != 0) ? UP : DOWN;
+	}
+
+	if (car->elevator.state == UP)
+	{
+		stop = nextStopAbove(car, pending);
+
+		if (stop == 0)	// Nothing left above, so turn around
+		{
+			car->elevator.state = DOWN;
+			stop = here ? 0 : nextStopBelow(car, pending, circular);
+		}
+
+		if (stop != 0)
+		{
+			car->elevator.destFloor = stop;
+		}
+	}
+	else if (car->elevator.state == DOWN)
+	{
+		stop = nextStopBelow(car, pending, circular);
+
+		if (stop == 0)	// Nothing left below, so turn around
+		{
+			car->elevator.state = UP;
+			stop = here ? 0 : nextStopAbove(car, pending);
+		}
+
+		if (stop != 0)
+		{
+			car->elevator.destFloor = stop;
+		}
+	}
+}
+
+static void lookPickNextFloor(Car * car, int draining)
+{
+	pendingFloors(car, car->floorScratch, draining);
+	lookNextFloor(car, car->floorScratch, 0);
+}
+
+static void clookPickNextFloor(Car * car, int draining)
+{
+	pendingFloors(car, car->floorScratch, draining);
+	lookNextFloor(car, car->floorScratch, 1);
+}
+
+static struct elevator_sched_ops lookOps =
+{
+	.name = "look",
+	.pick_next_floor = lookPickNextFloor,
+	.should_stop_here = hallCallHere,
+	.select_passengers_to_load = Load,
+};
+
+static struct elevator_sched_ops clookOps =
+{
+	.name = "clook",
+	.pick_next_floor = clookPickNextFloor,
+	.should_stop_here = hallCallHere,
+	.select_passengers_to_load = Load,
+};
+
+/**************************************************************************************************/
+
+/*
+Nearest call first. The elevator always heads for the closest floor with a hall call or car
+call, whichever way that is, keeping its direction when two floors are equally close. When
+passengers with a priority are waiting it heads the way of the closest of their floors
+instead, still stopping for the other calls on the way.
+*/
+
+/*
+Returns true if somebody waiting on a floor (0 based) has a priority above 0, either from
+their type or from waiting long enough for aging to lift them there.
+*/
+
+static int priorityFloor(Car * car, int floor, u64 now)
+{
+	Passenger * best;
+
+	if (test_bit(floor, car->queue.priorityCalls))
+	{
+		return 1;
+	}
+
+	best = bestWaiting(car, floor, UP, now);
+
+	if ((best != NULL) && (passengerPriority(best, now) > 0))
+	{
+		return 1;
+	}
+
+	best = bestWaiting(car, floor, DOWN, now);
+
+	return (best != NULL) && (passengerPriority(best, now) > 0);
+}
+
+/*
+Picks between heading up and heading down by the closest floor where a passenger with a
+priority above 0 is waiting, clearing the other way. Leaves both if those floors are the
+same distance away either way or are all on the current floor. Looks at the front of each
+type's queue on every floor with a hall call, so that aged passengers count too.
+*/
+
+static void priorityWay(Car * car, int * above, int * below)
+{
+	unsigned long * calls = car->queue.hallCalls;
+	int floor = car->elevator.currFloor;
+	int up = 0, down = 0;
+	int i;
+
+	u64 now = ktime_get_ns();
+
+	for (i = floor; i < numFloors; i++)
+	{
+		if (test_bit(i, calls) && priorityFloor(car, i, now))
+		{
+			up = i + 1;
+			break;
+		}
+	}
+
+	for (i = floor - 2; i >= 0; i--)
+	{
+		if (test_bit(i, calls) && priorityFloor(car, i, now))
+		{
+			down = i + 1;
+			break;
+		}
+	}
+
+	if ((up != 0) && ((down == 0) || (up - floor < floor - down)))
+	{
+		*below = 0;
+	}
+	else if ((down != 0) && ((up == 0) || (floor - down < up - floor)))
+	{
+		*above = 0;
+	}
+}
+
+static void nearestPickNextFloor(Car * car, int draining)
+{
+	int above, below;
+
+	pendingFloors(car, car->floorScratch, draining);
+	bitmap_andnot(car->floorScratch, car->floorScratch, car->refusedCalls, numFloors);
+
+	if (car->elevator.state == LOADING)
+	{
+		car->elevator.state = car->elevator.prevState;
+	}
+
+	above = nextStopAbove(car, car->floorScratch);
+	below = nextStopBelow(car, car->floorScratch, 0);
+
+	if ((!draining) && (above != 0) && (below != 0) && prioritiesSet())
+	{
+		priorityWay(car, &above, &below);	// Head for the closest priority call
+	}
+
+	if ((above != 0) && (below != 0))	// Calls both ways, so take the closer one
+	{
+		if (above - car->elevator.currFloor < car->elevator.currFloor - below)
+		{
+			below = 0;
+		}
+		else if (above - car->elevator.currFloor > car->elevator.currFloor - below)
+		{
+			above = 0;
+		}
+		else if (car->elevator.state == DOWN)
+		{
+			above = 0;
+		}
+		else
+		{
+			below = 0;
+		}
+	}
+
+	if (above != 0)
+	{
+		car->elevator.state = UP;
+		car->elevator.destFloor = above;
+	}
+	else if (below != 0)
+	{
+		car->elevator.state = DOWN;
+		car->elevator.destFloor = below;
+	}
+	else if ((car->elevator.state == IDLE) && test_bit(car->elevator.currFloor - 1, car->floorScratch))
+	{
+		car->elevator.state = UP;	// Only calls are here, so stay and board them
+	}
+}
+
+/*
+Nearest call first boards anyone waiting who fits, whichever way they are going, starting
+with those going the way the elevator is heading. A floor where nobody could board is
+passed over until someone gets off or someone new arrives there; otherwise a car too full
+for the people waiting nearby would keep going back to them instead of delivering its own
+passengers.
+*/
+
+static int nearestLoad(Car * car)
+{
+	int counter;
+
+	if (car->elevator.state == DOWN)
+	{
+		counter = boardFrom(car, DOWN);
+		counter += boardFrom(car, UP);
+	}
+	else
+	{
+		counter = boardFrom(car, UP);
+		counter += boardFrom(car, DOWN);
+	}
+
+	if ((counter == 0) && hallCallHere(car))
+	{
+		__set_bit(car->elevator.currFloor - 1, car->refusedCalls);
+	}
+
+	return counter;
+}
+
+static void nearestAttach(Car * car)
+{
+	bitmap_zero(car->refusedCalls, numFloors);
+}
+
+static void nearestRequestArrival(Car * car, Passenger * passenger)
+{
+	__clear_bit(passenger->start - 1, car->refusedCalls);
+}
+
+static struct elevator_sched_ops nearestOps =
+{
+	.name = "nearest",
+	.attach = nearestAttach,
+	.on_request_arrival = nearestRequestArrival,
+	.pick_next_floor = nearestPickNextFloor,
+	.should_stop_here = hallCallHere,
+	.select_passengers_to_load = nearestLoad,
+};
+
+/**************************************************************************************************/
+
+/*
+Destination dispatch. Waiting passengers are counted by start and destination floor, so the
+elevator can group riders going to the same place. Once the elevator is half full it only
+stops for waiting passengers going to a floor it is already stopping at, and it boards those
+passengers ahead of anyone who would add a new stop.
+*/
+
+// Each car's destWaiting is numFloors by numFloors, allocated by elevator_sched_init
+#define DEST_WAITING(car, start, dest) (car)->destWaiting[(start) * numFloors + (dest)]
+
+static void destAttach(Car * car)
+{
+	struct list_head * temp;
+	Passenger * passenger;
+	int i;
+
+	memset(car->destWaiting, 0, numFloors * numFloors * sizeof(*car->destWaiting));
+
+	for (i = 0; i < numFloors; i++)		// Recount everyone already waiting
+	{
+		list_for_each(temp, &car->queue.up[i])
+		{
+			passenger = list_entry(temp, Passenger, list);
+
+			DEST_WAITING(car, passenger->start - 1, passenger->dest - 1) += 1;
+		}
+
+		list_for_each(temp, &car->queue.down[i])
+		{
+			passenger = list_entry(temp, Passenger, list);
+
+			DEST_WAITING(car, passenger->start - 1, passenger->dest - 1) += 1;
+		}
+	}
+}
+
+static void destRequestArrival(Car * car, Passenger * passenger)
+{
+	DEST_WAITING(car, passenger->start - 1, passenger->dest - 1) += 1;
+}
+
+static void destRequestCancel(Car * car, Passenger * passenger)
+{
+	DEST_WAITING(car, passenger->start - 1, passenger->dest - 1) -= 1;
+}
+
+/*
+Returns true if the elevator should stop for the people waiting on the given floor.
+*/
+
+static int destWorthStopping(Car * car, int floor)
+{
+	int dest;
+
+	if (car->elevator.passUnit * 2 < maxPass)	// Plenty of room, take anyone
+	{
+		return 1;
+	}
+
+	for_each_set_bit(dest, car->elevator.carCalls, numFloors)
+	{
+		if (DEST_WAITING(car, floor, dest) != 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void destPickNextFloor(Car * car, int draining)
+{
+	int floor;
+
+	bitmap_copy(car->floorScratch, car->elevator.carCalls, numFloors);
+
+	if (!draining)
+	{
+		for_each_set_bit(floor, car->queue.hallCalls, numFloors)
+		{
+			if (destWorthStopping(car, floor))
+			{
+				__set_bit(floor, car->floorScratch);
+			}
+		}
+	}
+
+	lookNextFloor(car, car->floorScratch, 0);
+}
+
+static int destShouldStop(Car * car)
+{
+	return hallCallHere(car) && destWorthStopping(car, car->elevator.currFloor - 1);
+}
+
+/*
+Boards passengers going the given way in order. With sameStopOnly set, only those going to a
+floor the elevator is already stopping at are taken, so this pass may skip over people.
+*/
+
+static int destLoadPass(Car * car, int direction, int sameStopOnly)
+{
+	struct list_head * dummy = NULL;
+	struct list_head * temp = NULL;
+
+	struct Passenger * passenger = NULL;
+
+	int counter = 0;
+
+	list_for_each_safe(temp, dummy, hallQueue(car, direction))
+	{
+		if (atMax(car))
+		{
+			return counter;
+		}
+
+		passenger = list_entry(temp, Passenger, list);
+
+		if (Fits(car, passenger) && ((!sameStopOnly) || test_bit(passenger->dest - 1, car->elevator.carCalls)))
+		{
+			DEST_WAITING(car, passenger->start - 1, passenger->dest - 1) -= 1;
+			boardPassenger(car, passenger);
+			counter++;
+		}
+	}
+
+	return counter;
+}
+
+/*
+Boards passengers going the given way above priority 0, aging included, highest first, until
+the next of them does not fit. Does nothing unless some type has a priority.
+*/
+
+static int destLoadPriority(Car * car, int direction)
+{
+	Passenger * passenger = NULL;
+
+	u64 now = ktime_get_ns();
+	int counter = 0;
+
+	if (!prioritiesSet())
+	{
+		return 0;
+	}
+
+	while ((passenger = nextByPriority(car, direction, 1, now)) != NULL)
+	{
+		DEST_WAITING(car, passenger->start - 1, passenger->dest - 1) -= 1;
+		boardPassenger(car, passenger);
+		counter++;
+	}
+
+	return counter;
+}
+
+/*
+Boards priority passengers first, then those going to floors the car already stops at, then
+anyone else who fits, for each way the car can board.
+*/
+
+static int destLoad(Car * car)
+{
+	int counter = 0;
+
+	if (boardingWay(car, UP))
+	{
+		counter += destLoadPriority(car, UP);
+		counter += destLoadPass(car, UP, 1);
+		counter += destLoadPass(car, UP, 0);
+	}
+
+	if (boardingWay(car, DOWN))
+	{
+		counter += destLoadPriority(car, DOWN);
+		counter += destLoadPass(car, DOWN, 1);
+		counter += destLoadPass(car, DOWN, 0);
+	}
+
+	return counter;
+}
+
+static struct elevator_sched_ops destOps =
+{
+	.name = "dest",
+	.attach = destAttach,
+	.on_request_arrival = destRequestArrival,
+	.on_request_cancel = destRequestCancel,
+	.pick_next_floor = destPickNextFloor,
+	.should_stop_here = destShouldStop,
+	.select_passengers_to_load = destLoad,
+};
+
+/**************************************************************************************************/
+
+struct elevator_sched_ops * schedPolicies[] =
+{
+	&scanOps,
+	&lookOps,
+	&clookOps,
+	&nearestOps,
+	&destOps,
+	NULL
+};
+EXPORT_SYMBOL(schedPolicies);
+
+/*
+Allocates a car's scratch bitmap and the policies' per floor state for it once the number
+of floors is known. Returns -ENOMEM if that fails.
+*/
+
+int elevator_sched_init(Car * car)
+{
+	car->floorScratch = bitmap_zalloc(numFloors, GFP_KERNEL);
+	car->refusedCalls = bitmap_zalloc(numFloors, GFP_KERNEL);
+	car->destWaiting = kvcalloc(numFloors * numFloors, sizeof(*car->destWaiting), GFP_KERNEL);
+
+	fillItemsMax = BELLHOP * (ilog2(maxPass) + 2);
+	car->fillWeight = kvcalloc(maxPass + 1, sizeof(*car->fillWeight), GFP_KERNEL);
+	car->fillItem = kvcalloc(fillItemsMax, sizeof(*car->fillItem), GFP_KERNEL);
+	car->fillChoice = bitmap_zalloc(fillItemsMax * (maxPass + 1), GFP_KERNEL);
+
+	if ((car->floorScratch == NULL) || (car->refusedCalls == NULL) || (car->destWaiting == NULL) ||
+	    (car->fillWeight == NULL) || (car->fillItem == NULL) || (car->fillChoice == NULL))
+	{
+		elevator_sched_exit(car);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void elevator_sched_exit(Car * car)
+{
+	bitmap_free(car->floorScratch);
+	bitmap_free(car->refusedCalls);
+	kvfree(car->destWaiting);
+	kvfree(car->fillWeight);
+	kvfree(car->fillItem);
+	bitmap_free(car->fillChoice);
+
+	car->floorScratch = NULL;
+	car->refusedCalls = NULL;
+	car->destWaiting = NULL;
+	car->fillWeight = NULL;
+	car->fillItem = NULL;
+	car->fillChoice = NULL;
+}
+
+/*
+Returns the scheduling policy with the given name, or NULL if there is none.
+*/
+
+struct elevator_sched_ops * elevator_find_sched(const char * name)
+{
+	int i;
+
+	for (i = 0; schedPolicies[i] != NULL; i++)
+	{
+		if (strcmp(schedPolicies[i]->name, name) == 0)
+		{
+			return schedPolicies[i];
+		}
+	}
+
+	return NULL;
+}
@@ -0,0 +1,117 @@
+#ifndef __ELEVATOR_SCHED
+#define __ELEVATOR_SCHED
+
+#include "elevator.h"
+
+/*
+Hooks making up a scheduling policy. Every car runs the same policy on its own queue. The
+hooks are called by the car's thread with both of the car's elevatorMutex and queueMutex
+held, except for pick_next_floor while draining after a stop call (elevatorMutex only) and
+on_request_arrival (queueMutex only, when new arrivals are queued while the car is waiting).
+on_request_arrival and on_request_cancel are also called with only the queueMutex held by
+cancel_request and change_destination.
+*/
+
+struct elevator_sched_ops
+{
+	const char * name;
+	void (*attach)(Car * car);					// Rebuild policy state when switched in (optional)
+	void (*on_request_arrival)(Car * car, Passenger * passenger);	// A passenger was queued (optional)
+	void (*on_request_cancel)(Car * car, Passenger * passenger);	// A queued passenger left (optional)
+	void (*pick_next_floor)(Car * car, int draining);		// Update state and destination floor
+	int (*should_stop_here)(Car * car);				// Board waiting passengers at this floor?
+	int (*select_passengers_to_load)(Car * car);			// Board passengers, return how many
+};
+
+extern struct elevator_sched_ops * schedOps;
+extern struct elevator_sched_ops * schedPolicies[];
+
+extern struct Car * cars;
+extern int numCars;
+
+extern int numFloors;		// Building geometry and car limits, set by module parameters
+extern int maxPass;
+extern int maxWeight;
+
+extern int fillBoarding;	// Board with fillFrom rather than in order, set by boarding=fill
+extern int boardSkipMax;
+
+extern int typePriority[BELLHOP];	// Priority classes, see type_priority
+extern int priorityAging;
+extern int waitTarget[BELLHOP];
+
+/*
+Keeps the counters, load totals and per type queues of a car's queue in step as a passenger
+joins (delta 1) or leaves (delta -1) their floor queue, so nothing has to walk the queues to
+find them. Passengers join at the back of their type's queue. Called with the car's
+queueMutex held.
+*/
+
+static inline void queueCount(Car * car, Passenger * p, int delta)
+{
+	Queue * passQueue = &car->queue;
+	int floor = p->start - 1;
+	struct list_head * typeQueue;
+
+	if (p->dest > p->start)
+	{
+		typeQueue = &passQueue->upType[floor * BELLHOP + p->type - 1];
+		passQueue->upSize[floor] += delta;
+		passQueue->upPass[floor] += delta * p->passUnit;
+		passQueue->upWeight[floor] += delta * p->weightUnit;
+	}
+	else
+	{
+		typeQueue = &passQueue->downType[floor * BELLHOP + p->type - 1];
+		passQueue->downSize[floor] += delta;
+		passQueue->downPass[floor] += delta * p->passUnit;
+		passQueue->downWeight[floor] += delta * p->weightUnit;
+	}
+
+	if (delta > 0)
+	{
+		list_add_tail(&p->typeList, typeQueue);
+	}
+	else
+	{
+		list_del(&p->typeList);
+	}
+
+	passQueue->floorSize[floor] += delta;
+	passQueue->floorPass[floor] += delta * p->passUnit;
+	passQueue->floorWeight[floor] += delta * p->weightUnit;
+
+	if (p->priority > 0)	// Keep the priority calls in step too
+	{
+		passQueue->priorityWaiting[floor] += delta;
+
+		if (passQueue->priorityWaiting[floor] != 0)
+		{
+			__set_bit(floor, passQueue->priorityCalls);
+		}
+		else
+		{
+			__clear_bit(floor, passQueue->priorityCalls);
+		}
+	}
+
+	passQueue->size += delta;
+	passQueue->passUnit += delta * p->passUnit;
+	passQueue->weightUnit += delta * p->weightUnit;
+}
+
+#ifdef ELEVATOR_DEBUG
+void checkQueueTotals(Car * car);
+#else
+static inline void checkQueueTotals(Car * car) { }
+#endif
+
+int elevator_sched_init(Car * car);
+void elevator_sched_exit(Car * car);
+int Unload(Car * car);
+struct elevator_sched_ops * elevator_find_sched(const char * name);
+int elevator_set_sched(const char * name);
+
+void freePassenger(Passenger * passenger);	// Passenger pool, in elevator_main.c
+
+#endif
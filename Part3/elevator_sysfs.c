@@ -0,0 +1,269 @@
+#include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/slab.h>
+#include <linux/compiler.h>
+#include <linux/seqlock.h>
+
+#include "elevator.h"
+#include "elevator_sched.h"
+#include "elevator_sysfs.h"
+
+/*
+Every attribute reads one value from the status snapshot each car publishes under its
+statusLock seqlock, as /proc/elevator does, trying again if the car was publishing
+meanwhile. Reads never block the cars and cost the same however long the queues. Each file
+is read on its own, so values from different files need not be from the same moment;
+/proc/elevator gives a consistent report.
+*/
+
+struct ElevatorKobj
+{
+	struct kobject kobj;
+	int index;		// Car or floor, counting from 0
+};
+
+static struct ElevatorKobj * root;		// /sys/kernel/elevator, the first car's attributes
+static struct ElevatorKobj ** carKobjs;		// car1 to carN
+static struct ElevatorKobj ** floorKobjs;	// floor1 to floorN
+
+static const char * stateNames[NUM_STATES] = { "OFFLINE", "IDLE", "LOADING", "UP", "DOWN" };
+
+static int kobjIndex(struct kobject * kobj)
+{
+	return container_of(kobj, struct ElevatorKobj, kobj)->index;
+}
+
+static Car * kobjCar(struct kobject * kobj)
+{
+	return &cars[kobjIndex(kobj)];
+}
+
+static void releaseKobj(struct kobject * kobj)
+{
+	kfree(container_of(kobj, struct ElevatorKobj, kobj));
+}
+
+/**************************************************************************************************/
+
+// Reads one field of a car's status snapshot into value
+#define READ_STATUS(car, value, field)								\
+do												\
+{												\
+	unsigned int seq;									\
+												\
+	do											\
+	{											\
+		seq = read_seqbegin(&(car)->statusLock);					\
+		value = (car)->status->field;							\
+	} while (read_seqretry(&(car)->statusLock, seq));					\
+} while (0)
+
+static ssize_t state_show(struct kobject * kobj, struct kobj_attribute * attr, char * buf)
+{
+	int state;
+
+	READ_STATUS(kobjCar(kobj), state, state);
+
+	return sprintf(buf, "%s\n", ((state >= 0) && (state < NUM_STATES)) ? stateNames[state] : "UNKNOWN");
+}
+
+// Attributes that show one field of a car's struct ElevatorStatus
+#define ELEVATOR_ATTR(name, field, format)							\
+static ssize_t name##_show(struct kobject * kobj, struct kobj_attribute * attr, char * buf)	\
+{												\
+	typeof(((struct ElevatorStatus *) NULL)->field) value;					\
+												\
+	READ_STATUS(kobjCar(kobj), value, field);						\
+												\
+	return sprintf(buf, format "\n", value);						\
+}												\
+static struct kobj_attribute name##_attr = __ATTR(name, 0444, name##_show, NULL)
+
+static struct kobj_attribute state_attr = __ATTR(state, 0444, state_show, NULL);
+ELEVATOR_ATTR(current_floor, currFloor, "%d");
+ELEVATOR_ATTR(dest_floor, destFloor, "%d");
+ELEVATOR_ATTR(pass_units, passUnit, "%d");
+ELEVATOR_ATTR(weight_units, weightUnit, "%d");
+ELEVATOR_ATTR(floors_loaded, stats.floorsLoaded, "%ld");
+ELEVATOR_ATTR(floors_empty, stats.floorsEmpty, "%ld");
+ELEVATOR_ATTR(stops, stats.stops, "%ld");
+ELEVATOR_ATTR(useless_stops, stats.uselessStops, "%ld");
+
+static struct attribute * carAttrs[] =
+{
+	&state_attr.attr,
+	&current_floor_attr.attr,
+	&dest_floor_attr.attr,
+	&pass_units_attr.attr,
+	&weight_units_attr.attr,
+	&floors_loaded_attr.attr,
+	&floors_empty_attr.attr,
+	&stops_attr.attr,
+	&useless_stops_attr.attr,
+	NULL
+};
+
+static struct kobj_type carType =
+{
+	.release = releaseKobj,
+	.sysfs_ops = &kobj_sysfs_ops,
+	.default_attrs = carAttrs,
+};
+
+/**************************************************************************************************/
+
+// Attributes that show one field of a floor's struct FloorStatus, summed over the cars
+#define FLOOR_ATTR(name, field)									\
+static ssize_t name##_show(struct kobject * kobj, struct kobj_attribute * attr, char * buf)	\
+{												\
+	int floor = kobjIndex(kobj);								\
+	int sum = 0;										\
+	int value;										\
+	int c;											\
+												\
+	for (c = 0; c < numCars; c++)								\
+	{											\
+		READ_STATUS(&cars[c], value, floor[floor].field);				\
+		sum += value;									\
+	}											\
+												\
+	return sprintf(buf, "%d\n", sum);							\
+}												\
+static struct kobj_attribute name##_attr = __ATTR(name, 0444, name##_show, NULL)
+
+FLOOR_ATTR(waiting_pass_units, passUnit);
+FLOOR_ATTR(waiting_weight_units, weightUnit);
+FLOOR_ATTR(serviced, serviced);
+
+static struct attribute * floorAttrs[] =
+{
+	&waiting_pass_units_attr.attr,
+	&waiting_weight_units_attr.attr,
+	&serviced_attr.attr,
+	NULL
+};
+
+static struct kobj_type floorType =
+{
+	.release = releaseKobj,
+	.sysfs_ops = &kobj_sysfs_ops,
+	.default_attrs = floorAttrs,
+};
+
+/**************************************************************************************************/
+
+/*
+Creates a directory of the given type under parent, named by prefix and index + 1, or
+elevator if prefix is NULL. Returns NULL if it could not be created.
+*/
+
+static struct ElevatorKobj * addKobj(struct kobj_type * type, struct kobject * parent, const char * prefix, int index)
+{
+	struct ElevatorKobj * ek = kzalloc(sizeof(*ek), GFP_KERNEL);
+	int ret;
+
+	if (ek == NULL)
+	{
+		return NULL;
+	}
+
+	ek->index = index;
+
+	if (prefix == NULL)
+	{
+		ret = kobject_init_and_add(&ek->kobj, type, parent, "elevator");
+	}
+	else
+	{
+		ret = kobject_init_and_add(&ek->kobj, type, parent, "%s%d", prefix, index + 1);
+	}
+
+	if (ret != 0)
+	{
+		kobject_put(&ek->kobj);	// Frees it through releaseKobj
+		return NULL;
+	}
+
+	return ek;
+}
+
+/*
+Builds /sys/kernel/elevator once the cars are set up. Returns -ENOMEM if it could not.
+*/
+
+int elevator_sysfs_init(void)
+{
+	int i;
+
+	root = addKobj(&carType, kernel_kobj, NULL, 0);
+	carKobjs = kcalloc(numCars, sizeof(*carKobjs), GFP_KERNEL);
+	floorKobjs = kcalloc(numFloors, sizeof(*floorKobjs), GFP_KERNEL);
+
+	if ((root == NULL) || (carKobjs == NULL) || (floorKobjs == NULL))
+	{
+		elevator_sysfs_exit();
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < numCars; i++)
+	{
+		carKobjs[i] = addKobj(&carType, &root->kobj, "car", i);
+
+		if (carKobjs[i] == NULL)
+		{
+			elevator_sysfs_exit();
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < numFloors; i++)
+	{
+		floorKobjs[i] = addKobj(&floorType, &root->kobj, "floor", i);
+
+		if (floorKobjs[i] == NULL)
+		{
+			elevator_sysfs_exit();
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/*
+Removes /sys/kernel/elevator. Called before the cars are freed, and waits for any read
+still going on to finish.
+*/
+
+void elevator_sysfs_exit(void)
+{
+	int i;
+
+	for (i = 0; (floorKobjs != NULL) && (i < numFloors); i++)
+	{
+		if (floorKobjs[i] != NULL)
+		{
+			kobject_put(&floorKobjs[i]->kobj);
+		}
+	}
+
+	for (i = 0; (carKobjs != NULL) && (i < numCars); i++)
+	{
+		if (carKobjs[i] != NULL)
+		{
+			kobject_put(&carKobjs[i]->kobj);
+		}
+	}
+
+	if (root != NULL)
+	{
+		kobject_put(&root->kobj);
+	}
+
+	kfree(floorKobjs);
+	kfree(carKobjs);
+	floorKobjs = NULL;
+	carKobjs = NULL;
+	root = NULL;
+}
@@ -0,0 +1,13 @@
+#ifndef __ELEVATOR_SYSFS
+#define __ELEVATOR_SYSFS
+
+/*
+/sys/kernel/elevator, one read-only value per file. The top directory holds the first car's
+attributes, car1 to carN hold each car's, and floor1 to floorN hold each floor's summed over
+the cars.
+*/
+
+int elevator_sysfs_init(void);
+void elevator_sysfs_exit(void);
+
+#endif
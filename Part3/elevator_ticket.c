@@ -0,0 +1,539 @@
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/idr.h>
+#include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/cred.h>
+#include <linux/uidgid.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
+#include <linux/eventfd.h>
+#include <linux/err.h>
+#include <linux/uaccess.h>
+
+#include "elevator.h"
+#include "elevator_ticket.h"
+
+// Tickets not yet collected by wait_ticket, keyed by id. ticketLock covers the IDR and
+// the state and times of every ticket in it
+static DEFINE_IDR(tickets);
+static DEFINE_SPINLOCK(ticketLock);
+static int liveTickets;
+static LIST_HEAD(doneTickets);	// Delivered and not yet collected, oldest drop off first
+
+/*
+Number of tickets one user has in the IDR. Freed along with the user's last ticket.
+*/
+
+struct TicketUser
+{
+	struct hlist_node node;
+	kuid_t uid;
+	int tickets;
+};
+
+static DEFINE_HASHTABLE(ticketUsers, 6);
+
+// Waiters sleep on the queue their ticket id hashes to, so one delivery only wakes a few
+#define TICKET_WAIT_HASH 64
+static wait_queue_head_t ticketWait[TICKET_WAIT_HASH];
+
+static int max_tickets = 4096;
+module_param(max_tickets, int, 0644);
+MODULE_PARM_DESC(max_tickets, "Most tickets waiting to be collected at once (default 4096)");
+
+static int max_user_tickets = 1024;
+module_param(max_user_tickets, int, 0644);
+MODULE_PARM_DESC(max_user_tickets, "Most tickets one user may hold at once, 0 for no limit (default 1024)");
+
+static int ticket_expiry = 60;
+module_param(ticket_expiry, int, 0644);
+MODULE_PARM_DESC(ticket_expiry, "Seconds a delivered ticket waits to be collected before it is freed (default 60)");
+
+/**************************************************************************************************/
+
+void elevator_ticket_init(void)
+{
+	int i;
+
+	for (i = 0; i < TICKET_WAIT_HASH; i++)
+	{
+		init_waitqueue_head(&ticketWait[i]);
+	}
+}
+
+static struct TicketUser * findUser(kuid_t uid)
+{
+	struct TicketUser * user;
+
+	hash_for_each_possible(ticketUsers, user, node, __kuid_val(uid))
+	{
+		if (uid_eq(user->uid, uid))
+		{
+			return user;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+Counts one more ticket against the calling user, allocating their count on their first.
+Returns the count, or NULL if it could not be allocated.
+*/
+
+static struct TicketUser * getUser(void)
+{
+	struct TicketUser * user;
+	struct TicketUser * fresh = NULL;
+	kuid_t uid = current_uid();
+
+	spin_lock(&ticketLock);
+
+	user = findUser(uid);
+
+	if (user == NULL)	// First ticket of this user, so allocate outside the lock
+	{
+		spin_unlock(&ticketLock);
+
+		fresh = kzalloc(sizeof(*fresh), GFP_KERNEL);
+
+		if (fresh == NULL)
+		{
+			return NULL;
+		}
+
+		spin_lock(&ticketLock);
+
+		user = findUser(uid);
+
+		if (user == NULL)
+		{
+			user = fresh;
+			fresh = NULL;
+			user->uid = uid;
+			hash_add(ticketUsers, &user->node, __kuid_val(uid));
+		}
+	}
+
+	user->tickets += 1;
+
+	spin_unlock(&ticketLock);
+
+	kfree(fresh);
+
+	return user;
+}
+
+/*
+Takes a ticket off its user's count, freeing the count with their last ticket.
+*/
+
+static void putUser(struct TicketUser * user)
+{
+	spin_lock(&ticketLock);
+
+	user->tickets -= 1;
+
+	if (user->tickets == 0)
+	{
+		hash_del(&user->node);
+	}
+	else
+	{
+		user = NULL;
+	}
+
+	spin_unlock(&ticketLock);
+
+	kfree(user);
+}
+
+static void freeTicket(Ticket * ticket)
+{
+	if (ticket->eventfd != NULL)
+	{
+		eventfd_ctx_put(ticket->eventfd);
+	}
+
+	if (ticket->user != NULL)
+	{
+		putUser(ticket->user);
+	}
+
+	kfree(ticket);
+}
+
+/*
+Takes delivered tickets nobody has collected within ticket_expiry seconds out of the IDR and
+onto expired, for the caller to free once it lets go of ticketLock. A client that only
+watches its eventfd never calls wait_ticket, so without this its tickets would never go.
+*/
+
+static void expireTickets(struct list_head * expired, u64 now)
+{
+	u64 keep = (u64) max(READ_ONCE(ticket_expiry), 0) * NSEC_PER_SEC;
+	Ticket * ticket;
+
+	while (!list_empty(&doneTickets))
+	{
+		ticket = list_first_entry(&doneTickets, Ticket, done);
+
+		if (now - ticket->deliverTime < keep)
+		{
+			break;
+		}
+
+		idr_remove(&tickets, ticket->id);
+		liveTickets -= 1;
+		list_move_tail(&ticket->done, expired);
+	}
+}
+
+/*
+Frees every ticket left in the IDR. Called once the cars have stopped, so no passenger
+points at one any more.
+*/
+
+void elevator_ticket_exit(void)
+{
+	Ticket * ticket;
+	int id;
+
+	idr_for_each_entry(&tickets, ticket, id)
+	{
+		freeTicket(ticket);
+	}
+
+	idr_destroy(&tickets);
+	INIT_LIST_HEAD(&doneTickets);
+}
+
+/*
+Gives a new passenger, given to car by the dispatcher, a ticket, signalling the eventfd efd
+on pickup and drop off unless efd is negative. Returns the ticket id, -EBADF or -EINVAL if efd is not an eventfd, -EAGAIN
+if max_tickets are already waiting to be collected or the calling user already holds
+max_user_tickets, or -ENOMEM.
+*/
+
+int elevator_ticket_new(Passenger * passenger, Car * car, int efd)
+{
+	Ticket * ticket = kzalloc(sizeof(*ticket), GFP_KERNEL);
+	Ticket * old;
+	Ticket * tmp;
+	LIST_HEAD(expired);
+	int userMax = READ_ONCE(max_user_tickets);
+	int id;
+
+	if (ticket == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	INIT_LIST_HEAD(&ticket->done);
+	ticket->user = getUser();
+
+	if (ticket->user == NULL)
+	{
+		kfree(ticket);
+		return -ENOMEM;
+	}
+
+	if (efd >= 0)
+	{
+		ticket->eventfd = eventfd_ctx_fdget(efd);
+
+		if (IS_ERR(ticket->eventfd))
+		{
+			id = PTR_ERR(ticket->eventfd);
+			ticket->eventfd = NULL;
+			freeTicket(ticket);
+			return id;
+		}
+	}
+
+	ticket->state = TICKET_WAITING;
+	ticket->issueTime = passenger->issueTime;
+	ticket->car = car;
+	ticket->passenger = passenger;
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&ticketLock);
+
+	expireTickets(&expired, ktime_get_ns());
+
+	if ((liveTickets >= max_tickets) || ((userMax > 0) && (ticket->user->tickets > userMax)))
+	{
+		id = -EAGAIN;
+	}
+	else
+	{
+		id = idr_alloc_cyclic(&tickets, ticket, 1, 0, GFP_NOWAIT);	// Ids are never 0
+
+		if (id > 0)
+		{
+			ticket->id = id;
+			liveTickets += 1;
+		}
+	}
+
+	spin_unlock(&ticketLock);
+	idr_preload_end();
+
+	list_for_each_entry_safe(old, tmp, &expired, done)
+	{
+		freeTicket(old);
+	}
+
+	if (id < 0)
+	{
+		freeTicket(ticket);
+		return id;
+	}
+
+	passenger->ticket = ticket;
+
+	return id;
+}
+
+/*
+Moves a passenger's ticket on to ELEVATOR_TICKET_PICKUP or ELEVATOR_TICKET_DROPOFF, and
+signals its eventfd and wakes anyone waiting on it. Does nothing for a passenger issued
+without a ticket. Called by the car's thread with its mutexes held.
+*/
+
+void elevator_ticket_update(Passenger * passenger, int event, u64 now)
+{
+	Ticket * ticket = passenger->ticket;
+	int id;
+
+	if (ticket == NULL)
+	{
+		return;
+	}
+
+	spin_lock(&ticketLock);
+
+	id = ticket->id;
+	ticket->state = event;
+
+	if (event == ELEVATOR_TICKET_PICKUP)
+	{
+		ticket->boardTime = now;
+	}
+	else
+	{
+		ticket->deliverTime = now;
+		ticket->passenger = NULL;
+		passenger->ticket = NULL;	// wait_ticket may free it from here on
+		list_add_tail(&ticket->done, &doneTickets);
+	}
+
+	if (ticket->eventfd != NULL)
+	{
+		eventfd_signal(ticket->eventfd, 1);
+	}
+
+	spin_unlock(&ticketLock);
+
+	wake_up_all(&ticketWait[id % TICKET_WAIT_HASH]);
+}
+
+/*
+Returns the car a ticket's passenger was given to, or NULL if there is no such ticket. Cars
+live as long as the module, so the pointer stays good after the ticket is gone.
+*/
+
+Car * elevator_ticket_car(int id)
+{
+	Ticket * ticket;
+	Car * car = NULL;
+
+	spin_lock(&ticketLock);
+
+	ticket = idr_find(&tickets, id);
+
+	if (ticket != NULL)
+	{
+		car = ticket->car;
+	}
+
+	spin_unlock(&ticketLock);
+
+	return car;
+}
+
+/*
+Returns the passenger of a ticket still waiting on one of car's floor queues. Otherwise
+returns NULL with err set to -ENOENT if there is no such ticket, or -EBUSY if the passenger
+has been picked up. Called with the car's queueMutex held, so the passenger cannot be picked
+up until the caller lets go of it.
+*/
+
+Passenger * elevator_ticket_waiting(int id, Car * car, int * err)
+{
+	Ticket * ticket;
+	Passenger * passenger = NULL;
+
+	spin_lock(&ticketLock);
+
+	ticket = idr_find(&tickets, id);
+
+	if ((ticket == NULL) || (ticket->car != car))
+	{
+		*err = -ENOENT;
+	}
+	else if (ticket->state != TICKET_WAITING)
+	{
+		*err = -EBUSY;
+	}
+	else
+	{
+		passenger = ticket->passenger;
+	}
+
+	spin_unlock(&ticketLock);
+
+	return passenger;
+}
+
+/*
+Frees the ticket of a passenger who gave up waiting. Anyone in wait_ticket for it wakes up
+and gets -ENOENT, and its eventfd is signalled so pollers notice too.
+*/
+
+void elevator_ticket_cancel(Passenger * passenger)
+{
+	Ticket * ticket = passenger->ticket;
+	int id;
+
+	if (ticket == NULL)
+	{
+		return;
+	}
+
+	spin_lock(&ticketLock);
+
+	id = ticket->id;
+	idr_remove(&tickets, id);
+	liveTickets -= 1;
+
+	if (ticket->eventfd != NULL)
+	{
+		eventfd_signal(ticket->eventfd, 1);
+	}
+
+	spin_unlock(&ticketLock);
+
+	passenger->ticket = NULL;
+	freeTicket(ticket);
+
+	wake_up_all(&ticketWait[id % TICKET_WAIT_HASH]);
+}
+
+/*
+Returns true once a ticket has reached event, or if it is not there at all.
+*/
+
+static int ticketReached(int id, int event)
+{
+	Ticket * ticket;
+	int reached;
+
+	spin_lock(&ticketLock);
+
+	ticket = idr_find(&tickets, id);
+	reached = (ticket == NULL) || (ticket->state >= event);
+
+	spin_unlock(&ticketLock);
+
+	return reached;
+}
+
+/*
+Waits for a ticket to reach the event in flags, or only checks if ELEVATOR_TICKET_NOWAIT is
+set too. times, if not NULL, gets the issue, board and drop off times of the ticket, with 0
+for those still to come. Once the drop off has been waited for the ticket is collected and
+its id stops being valid. Returns 0, -EAGAIN if NOWAIT was given and the ticket is not there
+yet, -ENOENT if there is no such ticket, -EINTR if a signal came first, or -EINVAL.
+*/
+
+int elevator_ticket_wait(int id, int flags, u64 __user * times)
+{
+	Ticket * ticket;
+	u64 copy[3];
+	int event = flags & ~ELEVATOR_TICKET_NOWAIT;
+	int ret = 0;
+
+	if ((id <= 0) || ((event != ELEVATOR_TICKET_PICKUP) && (event != ELEVATOR_TICKET_DROPOFF)))
+	{
+		return -EINVAL;
+	}
+
+	if (!try_module_get(THIS_MODULE))	// Keep the module around while we sleep
+	{
+		return -ENODEV;
+	}
+
+	if (!ticketReached(id, event))
+	{
+		if (flags & ELEVATOR_TICKET_NOWAIT)
+		{
+			ret = -EAGAIN;
+			goto out;
+		}
+
+		ret = wait_event_interruptible(ticketWait[id % TICKET_WAIT_HASH], ticketReached(id, event));
+
+		if (ret != 0)
+		{
+			goto out;
+		}
+	}
+
+	spin_lock(&ticketLock);
+
+	ticket = idr_find(&tickets, id);
+
+	if (ticket != NULL)
+	{
+		copy[0] = ticket->issueTime;
+		copy[1] = ticket->boardTime;
+		copy[2] = ticket->deliverTime;
+
+		if (event == ELEVATOR_TICKET_DROPOFF)	// Collected, so it goes
+		{
+			idr_remove(&tickets, id);
+			list_del(&ticket->done);
+			liveTickets -= 1;
+		}
+		else
+		{
+			ticket = NULL;
+		}
+	}
+	else
+	{
+		ret = -ENOENT;
+	}
+
+	spin_unlock(&ticketLock);
+
+	if (ticket != NULL)
+	{
+		freeTicket(ticket);
+	}
+
+	if ((ret == 0) && (times != NULL) && copy_to_user(times, copy, sizeof(copy)))
+	{
+		ret = -EFAULT;
+	}
+
+out:
+	module_put(THIS_MODULE);
+
+	return ret;
+}
@@ -0,0 +1,46 @@
+#ifndef __ELEVATOR_TICKET
+#define __ELEVATOR_TICKET
+
+#include <linux/types.h>
+#include <linux/eventfd.h>
+
+#include "elevator.h"
+
+// Ticket state before its passenger is picked up; after that it is the last of
+// ELEVATOR_TICKET_PICKUP and ELEVATOR_TICKET_DROPOFF reached
+#define TICKET_WAITING 0
+
+struct TicketUser;
+
+/*
+A request issued with issue_ticket. It lives in the tickets IDR under its id until
+wait_ticket sees it delivered, so the caller can collect it after the passenger is gone.
+Delivered tickets nobody collects within ticket_expiry seconds are freed.
+*/
+
+struct Ticket
+{
+	int id;
+	int state;
+	u64 issueTime;			// ktime_get_ns when the request was issued
+	u64 boardTime;			// when the passenger boarded
+	u64 deliverTime;		// and when they got off
+	struct eventfd_ctx * eventfd;	// Signalled on pickup and drop off, or NULL
+	Car * car;			// Car the dispatcher gave the passenger to
+	Passenger * passenger;		// Until dropped off
+	struct TicketUser * user;	// Counts the tickets of the user who issued it
+	struct list_head done;		// On doneTickets once delivered, until collected
+};
+
+typedef struct Ticket Ticket;
+
+void elevator_ticket_init(void);
+void elevator_ticket_exit(void);
+int elevator_ticket_new(Passenger * passenger, Car * car, int efd);
+void elevator_ticket_update(Passenger * passenger, int event, u64 now);
+int elevator_ticket_wait(int id, int flags, u64 __user * times);
+Car * elevator_ticket_car(int id);
+Passenger * elevator_ticket_waiting(int id, Car * car, int * err);
+void elevator_ticket_cancel(Passenger * passenger);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+Tracepoints for the elevator. They show up under events/elevator in tracefs, so ftrace or
+perf can rebuild exactly what each car did and when. Every event carries the car it
+happened to, numbered from 0, and a disabled tracepoint costs only a static branch.
+*/
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM elevator
+
+#if !defined(_ELEVATOR_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ELEVATOR_TRACE_H
+
+#include <linux/tracepoint.h>
+
+#include "elevator.h"
+
+#define show_elevator_state(state)				\
+	__print_symbolic(state,					\
+		{ OFFLINE,	"OFFLINE" },			\
+		{ IDLE,		"IDLE" },			\
+		{ LOADING,	"LOADING" },			\
+		{ UP,		"UP" },				\
+		{ DOWN,		"DOWN" })
+
+TRACE_EVENT(elevator_request_issued,
+
+	TP_PROTO(int car, Passenger *passenger),
+
+	TP_ARGS(car, passenger),
+
+	TP_STRUCT__entry(
+		__field(int, car)
+		__field(int, type)
+		__field(int, start)
+		__field(int, dest)
+	),
+
+	TP_fast_assign(
+		__entry->car = car;
+		__entry->type = passenger->type;
+		__entry->start = passenger->start;
+		__entry->dest = passenger->dest;
+	),
+
+	TP_printk("car=%d type=%d start=%d dest=%d",
+		__entry->car, __entry->type, __entry->start, __entry->dest)
+);
+
+TRACE_EVENT(elevator_request_rejected,
+
+	TP_PROTO(int type, int start, int dest, const char *reason),
+
+	TP_ARGS(type, start, dest, reason),
+
+	TP_STRUCT__entry(
+		__field(int, type)
+		__field(int, start)
+		__field(int, dest)
+		__string(reason, reason)
+	),
+
+	TP_fast_assign(
+		__entry->type = type;
+		__entry->start = start;
+		__entry->dest = dest;
+		__assign_str(reason, reason);
+	),
+
+	TP_printk("type=%d start=%d dest=%d reason=%s",
+		__entry->type, __entry->start, __entry->dest, __get_str(reason))
+);
+
+DECLARE_EVENT_CLASS(elevator_passenger,
+
+	TP_PROTO(Car *car, Passenger *passenger),
+
+	TP_ARGS(car, passenger),
+
+	TP_STRUCT__entry(
+		__field(int, car)
+		__field(int, floor)
+		__field(int, state)
+		__field(int, type)
+		__field(int, start)
+		__field(int, dest)
+		__field(int, passUnit)
+		__field(int, weightUnit)
+	),
+
+	TP_fast_assign(
+		__entry->car = car->id;
+		__entry->floor = car->elevator.currFloor;
+		__entry->state = car->elevator.state;
+		__entry->type = passenger->type;
+		__entry->start = passenger->start;
+		__entry->dest = passenger->dest;
+		__entry->passUnit = car->elevator.passUnit;
+		__entry->weightUnit = car->elevator.weightUnit;
+	),
+
+	TP_printk("car=%d floor=%d state=%s type=%d start=%d dest=%d load=%d weight=%d",
+		__entry->car, __entry->floor, show_elevator_state(__entry->state),
+		__entry->type, __entry->start, __entry->dest,
+		__entry->passUnit, __entry->weightUnit)
+);
+
+DEFINE_EVENT(elevator_passenger, elevator_passenger_loaded,
+	TP_PROTO(Car *car, Passenger *passenger),
+	TP_ARGS(car, passenger)
+);
+
+DEFINE_EVENT(elevator_passenger, elevator_passenger_unloaded,
+	TP_PROTO(Car *car, Passenger *passenger),
+	TP_ARGS(car, passenger)
+);
+
+DEFINE_EVENT(elevator_passenger, elevator_passenger_cancelled,
+	TP_PROTO(Car *car, Passenger *passenger),
+	TP_ARGS(car, passenger)
+);
+
+DEFINE_EVENT(elevator_passenger, elevator_passenger_rerouted,
+	TP_PROTO(Car *car, Passenger *passenger),
+	TP_ARGS(car, passenger)
+);
+
+TRACE_EVENT(elevator_floor_departed,
+
+	TP_PROTO(Car *car),
+
+	TP_ARGS(car),
+
+	TP_STRUCT__entry(
+		__field(int, car)
+		__field(int, floor)
+		__field(int, dest)
+		__field(int, state)
+		__field(int, passUnit)
+		__field(int, weightUnit)
+	),
+
+	TP_fast_assign(
+		__entry->car = car->id;
+		__entry->floor = car->elevator.currFloor;
+		__entry->dest = car->elevator.destFloor;
+		__entry->state = car->elevator.state;
+		__entry->passUnit = car->elevator.passUnit;
+		__entry->weightUnit = car->elevator.weightUnit;
+	),
+
+	TP_printk("car=%d floor=%d dest=%d state=%s load=%d weight=%d",
+		__entry->car, __entry->floor, __entry->dest, show_elevator_state(__entry->state),
+		__entry->passUnit, __entry->weightUnit)
+);
+
+TRACE_EVENT(elevator_floor_arrived,
+
+	TP_PROTO(Car *car),
+
+	TP_ARGS(car),
+
+	TP_STRUCT__entry(
+		__field(int, car)
+		__field(int, floor)
+		__field(int, state)
+		__field(int, passUnit)
+		__field(int, weightUnit)
+	),
+
+	TP_fast_assign(
+		__entry->car = car->id;
+		__entry->floor = car->elevator.currFloor;
+		__entry->state = car->elevator.state;
+		__entry->passUnit = car->elevator.passUnit;
+		__entry->weightUnit = car->elevator.weightUnit;
+	),
+
+	TP_printk("car=%d floor=%d state=%s load=%d weight=%d",
+		__entry->car, __entry->floor, show_elevator_state(__entry->state),
+		__entry->passUnit, __entry->weightUnit)
+);
+
+TRACE_EVENT(elevator_state_change,
+
+	TP_PROTO(Car *car, int oldState),
+
+	TP_ARGS(car, oldState),
+
+	TP_STRUCT__entry(
+		__field(int, car)
+		__field(int, floor)
+		__field(int, oldState)
+		__field(int, state)
+	),
+
+	TP_fast_assign(
+		__entry->car = car->id;
+		__entry->floor = car->elevator.currFloor;
+		__entry->oldState = oldState;
+		__entry->state = car->elevator.state;
+	),
+
+	TP_printk("car=%d floor=%d %s -> %s",
+		__entry->car, __entry->floor,
+		show_elevator_state(__entry->oldState), show_elevator_state(__entry->state))
+);
+
+TRACE_EVENT(elevator_stop_requested,
+
+	TP_PROTO(Car *car),
+
+	TP_ARGS(car),
+
+	TP_STRUCT__entry(
+		__field(int, car)
+		__field(int, floor)
+		__field(int, state)
+		__field(int, passUnit)
+	),
+
+	TP_fast_assign(
+		__entry->car = car->id;
+		__entry->floor = car->elevator.currFloor;
+		__entry->state = car->elevator.state;
+		__entry->passUnit = car->elevator.passUnit;
+	),
+
+	TP_printk("car=%d floor=%d state=%s load=%d",
+		__entry->car, __entry->floor, show_elevator_state(__entry->state), __entry->passUnit)
+);
+
+#endif
+
+// The module is built out of tree, so define_trace.h has to be told where this file is
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE elevator_trace
+#include <trace/define_trace.h>